@@ -0,0 +1,133 @@
+/**
+ *
+ * memory_pool_colour_bench.cpp
+ *
+ * memory_pool_fixsize with cache colouring on and off: the cells are page sized, so
+ * without colouring the head of every cell maps to the same cache sets. the bench
+ * walks the first cache line of every cell for a number of rounds.
+ * then the false sharing run: every thread takes the next cell of an Align 1, 64 or 128
+ * pool of small cells and writes to its own cell in a tight loop
+ *
+ * build:   g++ -std=c++11 -O2 -I.. memory_pool_colour_bench.cpp -o memory_pool_colour_bench -pthread
+ * usage:   memory_pool_colour_bench [cell_count=512] [rounds=20000] [threads=4] [writes=20000000]
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <utility/pool/memory_pool.hpp>
+#include <utility/sync/null_mutex.hpp>
+
+typedef utility::memory_pool_fixsize<utility::sync::null_mutex, 64> pool_type;
+
+/**
+ * @brief walk the heads of the cells, return the nanoseconds per cell touch
+ */
+static double run(uint32_t colour_count, uint32_t cell_count, uint32_t rounds, uint64_t& checksum)
+{
+    pool_type pool(4096, cell_count, utility::slab_options(), colour_count);
+
+    std::vector<uint64_t*> cells(cell_count);
+    for (uint32_t i = 0; i < cell_count; ++i){
+        cells[i] = static_cast<uint64_t*>(pool.allocate());
+        for (uint32_t j = 0; j < 8; ++j){
+            cells[i][j] = i + j;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (uint32_t r = 0; r < rounds; ++r){
+        for (uint32_t i = 0; i < cell_count; ++i){
+            uint64_t* c = cells[i];
+            sum += c[0] + c[7];
+            c[1] = sum;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    for (uint32_t i = 0; i < cell_count; ++i){
+        pool.reclaim(cells[i]);
+    }
+
+    checksum += sum;
+    return ns / ((double)rounds * cell_count);
+}
+
+/**
+ * @brief threads writing to adjacent cells of an Align aligned pool, return the writes per second
+ */
+template<std::size_t Align>
+static double run_sharing(uint32_t threads, uint64_t writes, uint64_t& checksum)
+{
+    utility::memory_pool_fixsize<utility::sync::null_mutex, Align> pool(sizeof(uint64_t), threads);
+
+    std::vector<volatile uint64_t*> cells(threads);
+    for (uint32_t i = 0; i < threads; ++i){
+        cells[i] = static_cast<volatile uint64_t*>(pool.allocate());
+        *cells[i] = 0;
+    }
+
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; ++i){
+        workers.emplace_back([&, i]{
+            while (!go.load(std::memory_order_acquire)){
+                std::this_thread::yield();
+            }
+            volatile uint64_t* c = cells[i];
+            for (uint64_t n = 0; n < writes; ++n){
+                *c = *c + 1;
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : workers){
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (uint32_t i = 0; i < threads; ++i){
+        checksum += *cells[i];
+        pool.reclaim((void*)cells[i]);
+    }
+    return (double)writes * threads / seconds;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t cell_count = argc > 1 ? (uint32_t)atoi(argv[1]) : 512;
+    uint32_t rounds = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000;
+    uint32_t threads = argc > 3 ? (uint32_t)atoi(argv[3]) : 4;
+    uint64_t writes = argc > 4 ? strtoull(argv[4], nullptr, 10) : 20000000;
+    if (threads < 1){
+        threads = 1;
+    }
+    uint64_t checksum = 0;
+
+    const uint32_t colours[] = { 1, 2, 4, 8, 16, 64 };
+
+    printf("%-14s %16s\n", "colour_count", "ns/touch");
+    for (uint32_t colour_count : colours){
+        double ns = run(colour_count, cell_count, rounds, checksum);
+        printf("%-14u %16.3f\n", colour_count, ns);
+    }
+
+    printf("\n%-14s %16s\n", "align", "writes/s");
+    printf("%-14u %16.0f\n", 1u, run_sharing<1>(threads, writes, checksum));
+    printf("%-14u %16.0f\n", 64u, run_sharing<64>(threads, writes, checksum));
+    printf("%-14u %16.0f\n", 128u, run_sharing<128>(threads, writes, checksum));
+
+    // keep the loads alive
+    fprintf(stderr, "checksum %llu\n", (unsigned long long)checksum);
+    return 0;
+}
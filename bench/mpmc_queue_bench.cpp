@@ -0,0 +1,101 @@
+/**
+ *
+ * mpmc_queue_bench.cpp
+ *
+ * throughput of mpmc_queue with 1..N producers and 1..N consumers, every producer
+ * pushes the same count of items and the consumers pop until all are taken
+ *
+ * build:   g++ -std=c++11 -O2 -I.. mpmc_queue_bench.cpp -o mpmc_queue_bench -pthread
+ * usage:   mpmc_queue_bench [max_threads=4] [items_per_producer=1000000]
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <utility/mpmc_queue.hpp>
+
+typedef utility::mpmc_queue<uint64_t, 1024> queue_type;
+
+/**
+ * @brief run one round, return the items per second
+ */
+static double run(queue_type& queue, int32_t producers, int32_t consumers, uint64_t items_per_producer)
+{
+    const uint64_t total = items_per_producer * producers;
+    std::atomic<uint64_t> consumed(0);
+    std::atomic<uint64_t> checksum(0);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int32_t p = 0; p < producers; ++p){
+        threads.emplace_back([&, p]{
+            while (!go.load(std::memory_order_acquire)){
+                std::this_thread::yield();
+            }
+            for (uint64_t i = 0; i < items_per_producer; ++i){
+                queue.wait_push(i * producers + p);
+            }
+        });
+    }
+
+    for (int32_t c = 0; c < consumers; ++c){
+        threads.emplace_back([&]{
+            while (!go.load(std::memory_order_acquire)){
+                std::this_thread::yield();
+            }
+            uint64_t sum = 0;
+            uint64_t v = 0;
+            while (consumed.load(std::memory_order_relaxed) < total){
+                if (queue.pop(v)){
+                    sum += v;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+                else{
+                    std::this_thread::yield();
+                }
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads){
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the values pushed are 0 .. total - 1, each exactly once
+    if (checksum.load() != total * (total - 1) / 2){
+        fprintf(stderr, "checksum mismatch, p=%d c=%d\n", producers, consumers);
+        exit(1);
+    }
+    return total / seconds;
+}
+
+int main(int argc, char** argv)
+{
+    int32_t max_threads = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t items_per_producer = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    if (max_threads < 1){
+        max_threads = 1;
+    }
+
+    static queue_type queue;
+
+    printf("%-10s %-10s %16s\n", "producers", "consumers", "items/s");
+    for (int32_t p = 1; p <= max_threads; ++p){
+        for (int32_t c = 1; c <= max_threads; ++c){
+            double rate = run(queue, p, c, items_per_producer);
+            printf("%-10d %-10d %16.0f\n", p, c, rate);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ *
+ * time_wheel_test.cpp
+ *
+ * regression tests of the time_wheel handle and cancel paths
+ *
+ * build:   g++ -std=c++11 -I.. time_wheel_test.cpp -o time_wheel_test -pthread
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#include <stdio.h>
+#include <assert.h>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <utility/time_wheel.hpp>
+
+using utility::timer_handle;
+
+class test_wheel : public utility::time_wheel<std::mutex>
+{
+public:
+    uint32_t node_capacity()
+    {
+        return node_capacity_.load();
+    }
+};
+
+static void tick_for(test_wheel& wheel, int32_t ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end){
+        wheel.tick();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+/**
+ * @brief a one shot call back adding its timer again and then cancelling it, the
+ * node must stay a tombstone in its slot instead of going to the free list
+ */
+static void test_readd_then_cancel_in_callback()
+{
+    test_wheel wheel;
+    int32_t fired = 0;
+    int32_t others = 0;
+
+    for (int32_t round = 0; round < 20; ++round){
+        timer_handle* h = wheel.make_timer([&](timer_handle* self){
+            ++fired;
+            wheel.add_timer(self);
+            wheel.cancel(self);
+        }, 0);
+        wheel.add_timer(h);
+        tick_for(wheel, 12);
+
+        // new timers reuse the freed nodes, the slot lists must stay intact
+        for (int32_t i = 0; i < 4; ++i){
+            wheel.add_timer(wheel.make_timer([&](timer_handle* self){
+                ++others;
+                wheel.free_timer(self);
+            }, 0));
+        }
+        tick_for(wheel, 12);
+        assert(!wheel.cancel(h));
+    }
+
+    assert(fired == 20);
+    assert(others == 80);
+    printf("test_readd_then_cancel_in_callback ok\n");
+}
+
+/**
+ * @brief made and freed timers are reclaimed without a tick
+ */
+static void test_free_without_tick()
+{
+    test_wheel wheel;
+    for (int32_t i = 0; i < 100000; ++i){
+        timer_handle* h = wheel.make_timer([](timer_handle*){}, 1000);
+        wheel.free_timer(h);
+    }
+
+    assert(wheel.node_capacity() <= 1024);
+    printf("test_free_without_tick ok, capacity %u\n", wheel.node_capacity());
+}
+
+/**
+ * @brief an empty handler gives no timer instead of crashing the tick
+ */
+static void test_empty_handler()
+{
+    test_wheel wheel;
+    assert(!wheel.make_timer(std::function<void(timer_handle*)>(), 0));
+    void (*null_fn)(timer_handle*) = nullptr;
+    assert(!wheel.make_periodic_timer(null_fn, 10, 0));
+    wheel.add_timer(nullptr);
+    wheel.tick();
+    printf("test_empty_handler ok\n");
+}
+
+int main()
+{
+    test_readd_then_cancel_in_callback();
+    test_free_without_tick();
+    test_empty_handler();
+    return 0;
+}
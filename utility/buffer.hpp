@@ -11,15 +11,24 @@
 #define __utility_buffer_hpp__
 
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include "endian.hpp"
 
 namespace utility
 {
 class buffer;
 typedef std::shared_ptr<buffer> buffer_ptr;
+
+/**
+ * @brief create a buffer from the buffer pool(see buffer_pool.hpp)
+ */
+inline buffer_ptr make_pooled_buffer(int32_t size, bool auto_extend);
+
 class buffer
 {
 public:
@@ -35,6 +44,8 @@ protected:
     int32_t reader_index_mark_;
     bool    is_wrappered_;
     bool    is_auto_extend_;
+    bool    is_circular_;               // the storage is mapped twice(see circular_buffer.hpp)
+    std::atomic<int32_t> pin_count_;    // the storage is shared by slices, it can not be moved
 public:
     buffer()
         : data_(0)
@@ -44,6 +55,8 @@ public:
         , reader_index_mark_(0)
         , is_wrappered_(false)
         , is_auto_extend_(false)
+        , is_circular_(false)
+        , pin_count_(0)
     {}
 
     buffer(int32_t size, bool auto_extend = false)
@@ -54,13 +67,23 @@ public:
         , reader_index_mark_(0)
         , is_wrappered_(false)
         , is_auto_extend_(auto_extend)
+        , is_circular_(false)
+        , pin_count_(0)
     {
         allocate(size);
     }
 
+    /**
+     * @brief create a buffer, when UTILITY_BUFFER_USE_POOL is defined the buffer
+     * and its storage are drawn from the buffer pool
+     */
     static buffer_ptr create(int32_t size, bool auto_extend = false)
     {
+#ifdef UTILITY_BUFFER_USE_POOL
+        return make_pooled_buffer(size, auto_extend);
+#else
         return std::make_shared<buffer>(size, auto_extend);
+#endif
     }
 
     virtual ~buffer(){
@@ -109,6 +132,10 @@ public:
     }
 
     int32_t capacity(){
+        if (is_circular_){
+            // the writable bytes must be contiguous in the double mapped storage
+            return (std::min)(capacity_ - readable_bytes(), 2 * capacity_ - writer_index_);
+        }
         return capacity_ - writer_index_;
     }
 
@@ -137,7 +164,7 @@ public:
     }
 
     void    set_reader_index(int32_t index){
-        if (index >= 0 && index < capacity_)
+        if (index >= 0 && index < (is_circular_ ? 2 * capacity_ : capacity_))
             reader_index_ = index;
         else
             throw std::runtime_error("set reader index out of bounds");
@@ -158,7 +185,7 @@ public:
     }
 
     void    set_write_index(int32_t index){
-        if (index >= 0 && index <= capacity_)
+        if (index >= 0 && index <= (is_circular_ ? 2 * capacity_ : capacity_))
             writer_index_ = index;
         else
             throw std::runtime_error("set write index out of bounds.");
@@ -256,11 +283,89 @@ public:
         return v;
     }
 
+    /** big endian(network byte order) */
+    int16_t read_int16_be(){
+        return read_be<int16_t>();
+    }
+
+    uint16_t read_uint16_be(){
+        return read_be<uint16_t>();
+    }
+
+    int32_t read_int32_be(){
+        return read_be<int32_t>();
+    }
+
+    uint32_t read_uint32_be(){
+        return read_be<uint32_t>();
+    }
+
+    int64_t read_int64_be(){
+        return read_be<int64_t>();
+    }
+
+    uint64_t read_uint64_be(){
+        return read_be<uint64_t>();
+    }
+
+    /** little endian */
+    int16_t read_int16_le(){
+        return read_le<int16_t>();
+    }
+
+    uint16_t read_uint16_le(){
+        return read_le<uint16_t>();
+    }
+
+    int32_t read_int32_le(){
+        return read_le<int32_t>();
+    }
+
+    uint32_t read_uint32_le(){
+        return read_le<uint32_t>();
+    }
+
+    int64_t read_int64_le(){
+        return read_le<int64_t>();
+    }
+
+    uint64_t read_uint64_le(){
+        return read_le<uint64_t>();
+    }
+
+    /**
+     * @brief read count elements of T(int16/32/64, float, double...) in host byte order,
+     * the readable bytes are checked once for the whole array
+     * @return the count of elements actually read
+     */
+    template<typename T>
+    int32_t read_array(T* dst, int32_t count){
+        return read_array_impl(dst, count, false);
+    }
+
+    /**
+     * @brief read count elements of T stored in big endian, the bytes are swapped in one pass
+     */
+    template<typename T>
+    int32_t read_array_be(T* dst, int32_t count){
+        return read_array_impl(dst, count, endian::is_little());
+    }
+
+    /**
+     * @brief read count elements of T stored in little endian, the bytes are swapped in one pass
+     */
+    template<typename T>
+    int32_t read_array_le(T* dst, int32_t count){
+        return read_array_impl(dst, count, !endian::is_little());
+    }
+
+    /**
+     * @brief false when the space is not enough and the buffer can not grow, an auto extend
+     * buffer throws std::runtime_error instead when it is pinned by slices
+     */
     bool write_bytes(const char* data, int32_t len){
-        if (capacity() < len){
-            if (!resize(len)){
-                return false;
-            }
+        if (!ensure_writable(len)){
+            return false;
         }
 
         memcpy(data_ + writer_index_, data, len);
@@ -300,8 +405,105 @@ public:
         return write(v);
     }
 
+    /** big endian(network byte order) */
+    bool write_int16_be(int16_t v){
+        return write_be(v);
+    }
+
+    bool write_uint16_be(uint16_t v){
+        return write_be(v);
+    }
+
+    bool write_int32_be(int32_t v){
+        return write_be(v);
+    }
+
+    bool write_uint32_be(uint32_t v){
+        return write_be(v);
+    }
+
+    bool write_int64_be(int64_t v){
+        return write_be(v);
+    }
+
+    bool write_uint64_be(uint64_t v){
+        return write_be(v);
+    }
+
+    /** little endian */
+    bool write_int16_le(int16_t v){
+        return write_le(v);
+    }
+
+    bool write_uint16_le(uint16_t v){
+        return write_le(v);
+    }
+
+    bool write_int32_le(int32_t v){
+        return write_le(v);
+    }
+
+    bool write_uint32_le(uint32_t v){
+        return write_le(v);
+    }
+
+    bool write_int64_le(int64_t v){
+        return write_le(v);
+    }
+
+    bool write_uint64_le(uint64_t v){
+        return write_le(v);
+    }
+
+    /**
+     * @brief write count elements of T(int16/32/64, float, double...) in host byte order,
+     * the capacity is checked(and extended) once for the whole array
+     */
+    template<typename T>
+    bool write_array(const T* src, int32_t count){
+        return write_array_impl(src, count, false);
+    }
+
+    /**
+     * @brief write count elements of T in big endian, the bytes are swapped in one pass
+     */
+    template<typename T>
+    bool write_array_be(const T* src, int32_t count){
+        return write_array_impl(src, count, endian::is_little());
+    }
+
+    /**
+     * @brief write count elements of T in little endian, the bytes are swapped in one pass
+     */
+    template<typename T>
+    bool write_array_le(const T* src, int32_t count){
+        return write_array_impl(src, count, !endian::is_little());
+    }
+
+    /**
+     * @brief pin the storage, while pinned compact() does nothing and the
+     * buffer will not grow, so the slices over it stay valid(see buffer_slice.hpp).
+     * a write needing an auto extend buffer to grow throws std::runtime_error meanwhile
+     */
+    void pin(){
+        pin_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unpin(){
+        pin_count_.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool is_pinned(){
+        return pin_count_.load(std::memory_order_acquire) > 0;
+    }
+
     void compact(){
-        if (reader_index_ > 0){
+        if (is_circular_){
+            wrap_indices();
+            return;
+        }
+
+        if (reader_index_ > 0 && !is_pinned()){
             memmove(data_, data(), readable_bytes());
             writer_index_ = readable_bytes();
             reader_index_ = 0;
@@ -323,12 +525,95 @@ protected:
         return write_bytes(data, size);
     }
 
+    template<typename T>
+    T read_be(){
+        T v;
+        read(v);
+        return endian::big_to_host(v);
+    }
+
+    template<typename T>
+    T read_le(){
+        T v;
+        read(v);
+        return endian::little_to_host(v);
+    }
+
+    template<typename T>
+    bool write_be(T v){
+        return write(endian::host_to_big(v));
+    }
+
+    template<typename T>
+    bool write_le(T v){
+        return write(endian::host_to_little(v));
+    }
+
+    template<typename T>
+    int32_t read_array_impl(T* dst, int32_t count, bool swap){
+        int32_t to_read_count = (std::min)(count, readable_bytes() / (int32_t)sizeof(T));
+        int32_t len = to_read_count * (int32_t)sizeof(T);
+
+        if (swap){
+            endian::swap_array<sizeof(T)>(dst, data(), to_read_count);
+        }
+        else{
+            memcpy(dst, data(), len);
+        }
+        reader_index_ += len;
+        return to_read_count;
+    }
+
+    template<typename T>
+    bool write_array_impl(const T* src, int32_t count, bool swap){
+        int32_t len = count * (int32_t)sizeof(T);
+        if (!ensure_writable(len)){
+            return false;
+        }
+
+        if (swap){
+            endian::swap_array<sizeof(T)>(data_ + writer_index_, src, count);
+        }
+        else{
+            memcpy(data_ + writer_index_, src, len);
+        }
+        writer_index_ += len;
+        return true;
+    }
+
+    bool    ensure_writable(int32_t len){
+        if (capacity() < len && is_circular_){
+            wrap_indices();
+        }
+
+        if (capacity() < len){
+            if (!resize(len)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief allocate the storage, size is the requested size and returns the
+     * actual size of the storage(may be rounded up by the derived buffers)
+     */
+    virtual char* alloc_storage(int32_t& size)
+    {
+        return new char[size];
+    }
+
+    virtual void  free_storage(char* p, int32_t /*size*/)
+    {
+        delete[] p;
+    }
+
     void    allocate(int32_t size)
     {
         if (data_){
             throw std::runtime_error("the buffer can not allocate memory more than once.");
         }else{
-            data_ = new char[size];
+            data_ = alloc_storage(size);
             if (data_ == 0){
                 throw std::runtime_error("buffer allocate memory failed.");
             }
@@ -336,11 +621,29 @@ protected:
         }
     }
 
+    /**
+     * @brief circular mode, move the indices back by a whole capacity once the reader
+     * index passed the first mapping, the bytes are not moved(the second mapping aliases
+     * the first one). the reader index mark is kept only if it passed the first mapping too
+     */
+    void    wrap_indices(){
+        if (reader_index_ >= capacity_){
+            reader_index_ -= capacity_;
+            writer_index_ -= capacity_;
+            reader_index_mark_ = (std::max)(reader_index_mark_ - capacity_, 0);
+        }
+    }
+
     bool    resize(int32_t size){
 
-        if (!is_auto_extend_)
+        if (!is_auto_extend_ || is_circular_)
             return false;
 
+        // an auto extend buffer never fails a write quietly, growing would move the bytes under the slices
+        if (is_pinned()){
+            throw std::runtime_error("the buffer is pinned by slices and can not grow.");
+        }
+
         uint32_t new_capacity = (std::min<uint32_t>)(capacity_ * 2, max_buffer_size);
         new_capacity = (std::max<uint32_t>)(new_capacity, writer_index_ + size);
 
@@ -351,21 +654,27 @@ protected:
             return false;
         }
 
-        char* new_data = new char[new_capacity];
+        int32_t new_size = (int32_t)new_capacity;
+        char* new_data = alloc_storage(new_size);
         int32_t readable_len = readable_bytes();
         memcpy(new_data, data(), readable_len);
 
         writer_index_ = readable_len;
         reader_index_ = 0;
-        capacity_ = new_capacity;
 
-        if ( data_ )
-            delete[] data_;
+        if ( data_ && !is_wrappered_ )
+            free_storage(data_, capacity_);
         data_ = new_data;
+        capacity_ = new_size;
+        is_wrappered_ = false;
 
         return true;
     }
 };
 }
 
+#ifdef UTILITY_BUFFER_USE_POOL
+#include "buffer_pool.hpp"
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,329 @@
+﻿/**
+ *
+ * buffer_chain.hpp
+ *
+ * a chain of buffer segments, segments can be appended, prepended and spliced
+ * without copying the payload, and the chain can be handed to asio directly as
+ * a ConstBufferSequence/MutableBufferSequence (scatter/gather io)
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_buffer_chain_hpp__
+#define __utility_buffer_chain_hpp__
+
+#include "buffer.hpp"
+#include "asio_base/asio_standalone.hpp"
+#include <asio/buffer.hpp>
+#include <stdint.h>
+#include <deque>
+#include <iterator>
+
+namespace utility
+{
+class buffer_chain;
+typedef std::shared_ptr<buffer_chain> buffer_chain_ptr;
+class buffer_chain
+{
+public:
+    typedef std::deque<buffer_ptr>  segment_list;
+
+    /**
+     * @brief adapt the segment list to an asio buffer sequence, Buffer is
+     * asio::const_buffer(the readable bytes of each segment) or
+     * asio::mutable_buffer(the writable space of each segment)
+     * the sequence only refers to the chain, the chain must outlive it
+     */
+    template<typename Buffer>
+    class buffer_sequence
+    {
+    public:
+        typedef Buffer value_type;
+
+        class const_iterator
+        {
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef Buffer                          value_type;
+            typedef std::ptrdiff_t                  difference_type;
+            typedef const Buffer*                   pointer;
+            typedef Buffer                          reference;
+
+            const_iterator(){}
+
+            explicit const_iterator(segment_list::const_iterator iter)
+                : iter_(iter)
+            {}
+
+            Buffer operator*() const {
+                return make_buffer(*iter_, (Buffer*)0);
+            }
+
+            const_iterator& operator++(){
+                ++iter_;
+                return *this;
+            }
+
+            const_iterator operator++(int){
+                const_iterator tmp(*this);
+                ++iter_;
+                return tmp;
+            }
+
+            const_iterator& operator--(){
+                --iter_;
+                return *this;
+            }
+
+            const_iterator operator--(int){
+                const_iterator tmp(*this);
+                --iter_;
+                return tmp;
+            }
+
+            bool operator==(const const_iterator& other) const {
+                return iter_ == other.iter_;
+            }
+
+            bool operator!=(const const_iterator& other) const {
+                return iter_ != other.iter_;
+            }
+
+        private:
+            static asio::const_buffer make_buffer(const buffer_ptr& seg, asio::const_buffer*){
+                return asio::const_buffer(seg->data(), seg->readable_bytes());
+            }
+
+            static asio::mutable_buffer make_buffer(const buffer_ptr& seg, asio::mutable_buffer*){
+                return asio::mutable_buffer(seg->data() + seg->readable_bytes(), seg->capacity());
+            }
+
+        private:
+            segment_list::const_iterator iter_;
+        };
+
+        explicit buffer_sequence(const segment_list& segments, size_t first = 0)
+            : segments_(&segments)
+            , first_(first)
+        {}
+
+        const_iterator begin() const {
+            return const_iterator(segments_->begin() + first_);
+        }
+
+        const_iterator end() const {
+            return const_iterator(segments_->end());
+        }
+
+    private:
+        const segment_list* segments_;
+        size_t              first_;
+    };
+
+    typedef buffer_sequence<asio::const_buffer>     const_buffers_type;
+    typedef buffer_sequence<asio::mutable_buffer>   mutable_buffers_type;
+
+protected:
+    segment_list    segments_;
+    int32_t         readable_bytes_;
+
+public:
+    buffer_chain()
+        : readable_bytes_(0)
+    {}
+
+    static buffer_chain_ptr create()
+    {
+        return std::make_shared<buffer_chain>();
+    }
+
+public:
+    /**
+     * @brief append a segment to the tail of the chain, the segment is shared, not copied,
+     * do not write to the segment through other references while it is in the chain
+     */
+    void append(const buffer_ptr& seg){
+        if (seg){
+            segments_.push_back(seg);
+            readable_bytes_ += seg->readable_bytes();
+        }
+    }
+
+    /**
+     * @brief prepend a segment(e.g. a packet header) to the head of the chain
+     */
+    void prepend(const buffer_ptr& seg){
+        if (seg){
+            segments_.push_front(seg);
+            readable_bytes_ += seg->readable_bytes();
+        }
+    }
+
+    /**
+     * @brief move all the segments of other to the tail of the chain, other will be empty
+     */
+    void append(buffer_chain& other){
+        splice(segments_.size(), other);
+    }
+
+    /**
+     * @brief move all the segments of other to the head of the chain, other will be empty
+     */
+    void prepend(buffer_chain& other){
+        splice(0, other);
+    }
+
+    /**
+     * @brief move all the segments of other in front of the segment at index pos
+     */
+    void splice(size_t pos, buffer_chain& other){
+        if (&other == this){
+            return;
+        }
+
+        if (pos > segments_.size()){
+            throw std::runtime_error("splice position out of bounds.");
+        }
+
+        segments_.insert(segments_.begin() + pos, other.segments_.begin(), other.segments_.end());
+        readable_bytes_ += other.readable_bytes_;
+        other.clear();
+    }
+
+    /**
+     * @brief detach the segment at the head of the chain
+     */
+    buffer_ptr pop_front(){
+        if (segments_.empty()){
+            return buffer_ptr();
+        }
+
+        buffer_ptr seg = segments_.front();
+        segments_.pop_front();
+        readable_bytes_ -= seg->readable_bytes();
+        return seg;
+    }
+
+    void clear(){
+        segments_.clear();
+        readable_bytes_ = 0;
+    }
+
+    bool empty(){
+        return segments_.empty();
+    }
+
+    size_t segment_count(){
+        return segments_.size();
+    }
+
+    const segment_list& segments(){
+        return segments_;
+    }
+
+    int32_t readable_bytes(){
+        return readable_bytes_;
+    }
+
+    bool is_readable(){
+        return readable_bytes_ > 0;
+    }
+
+    /**
+     * @brief writable space of the segments, from the last segment holding readable bytes
+     * to the tail(see prepare)
+     */
+    int32_t capacity(){
+        int32_t total = 0;
+        for (segment_list::iterator iter = segments_.begin() + first_writable(); iter != segments_.end(); ++iter){
+            total += (*iter)->capacity();
+        }
+        return total;
+    }
+
+    /**
+     * @brief the readable bytes of each segment, for asio::async_write/gather write
+     */
+    const_buffers_type data() const {
+        return const_buffers_type(segments_);
+    }
+
+    /**
+     * @brief the writable space of each segment, for asio::async_read/scatter read.
+     * only the segments from the last one holding readable bytes are exposed, the free
+     * space of the segments before it would put the new bytes ahead of older ones
+     */
+    mutable_buffers_type prepare() const {
+        return mutable_buffers_type(segments_, first_writable());
+    }
+
+    /**
+     * @brief drop size readable bytes from the head of the chain(e.g. after a write completed),
+     * the fully consumed segments are released
+     * @return the bytes actually dropped
+     */
+    int32_t consume(int32_t size){
+        int32_t dropped = 0;
+        while (size > 0 && !segments_.empty()){
+            buffer_ptr& seg = segments_.front();
+            int32_t n = seg->drop_read(size);
+            dropped += n;
+            size -= n;
+
+            if (seg->is_readable()){
+                break;
+            }
+            segments_.pop_front();
+        }
+
+        readable_bytes_ -= dropped;
+        return dropped;
+    }
+
+    /**
+     * @brief make size bytes that were read into prepare() readable, the writable
+     * space of the segments is filled in order
+     * @return the bytes actually committed
+     */
+    int32_t commit(int32_t size){
+        int32_t committed = 0;
+        for (segment_list::iterator iter = segments_.begin() + first_writable(); iter != segments_.end() && size > 0; ++iter){
+            buffer_ptr& seg = *iter;
+            int32_t n = (std::min)(size, seg->capacity());
+            seg->set_write_index(seg->writer_index() + n);
+            committed += n;
+            size -= n;
+        }
+
+        readable_bytes_ += committed;
+        return committed;
+    }
+
+    /**
+     * @brief gather the readable bytes of the chain into one contiguous buffer
+     */
+    buffer_ptr flatten(){
+        buffer_ptr buf = buffer::create(readable_bytes_);
+        for (segment_list::iterator iter = segments_.begin(); iter != segments_.end(); ++iter){
+            buf->write_bytes((*iter)->data(), (*iter)->readable_bytes());
+        }
+        return buf;
+    }
+
+protected:
+    /**
+     * @brief the index of the last segment holding readable bytes, 0 if there is none
+     */
+    size_t first_writable() const {
+        for (size_t i = segments_.size(); i > 0; --i){
+            if (segments_[i - 1]->readable_bytes() > 0){
+                return i - 1;
+            }
+        }
+        return 0;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,270 @@
+﻿/**
+ *
+ * buffer_pool.hpp
+ *
+ * a size-class pool for buffer, the storage of a buffer and the shared_ptr
+ * control block(with the buffer object) are both recycled by power-of-two size
+ * classes from a per-thread free list
+ *
+ * define UTILITY_BUFFER_USE_POOL to make buffer::create draw from the pool
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_buffer_pool_hpp__
+#define __utility_buffer_pool_hpp__
+
+#include "buffer.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <new>
+
+namespace utility
+{
+class buffer_pool
+{
+public:
+    enum {
+        min_class_shift = 6,                                        // 64B
+        max_class_shift = 19,                                       // 512KB, the buffer::max_buffer_size
+        class_count = max_class_shift - min_class_shift + 1,
+        max_cached_bytes_per_class = 1024 * 1024,                   // per thread
+        min_cached_count_per_class = 4,                             // per thread
+    };
+
+    struct stats
+    {
+        uint64_t hits;              // allocation served by the free lists
+        uint64_t misses;            // allocation go to the global allocator
+        uint64_t parked_bytes;      // bytes parked in the free lists of all threads
+    };
+
+protected:
+    struct free_block {
+        free_block* next;
+    };
+
+    struct free_list {
+        free_block* head;
+        uint32_t    count;
+    };
+
+    /**
+     * @brief the free lists of one thread, returned to the global allocator when the thread exits
+     */
+    struct thread_cache {
+        free_list   lists[class_count];
+        bool*       destroyed;
+
+        thread_cache(bool* flag) : destroyed(flag) {
+            memset(lists, 0, sizeof(lists));
+        }
+
+        ~thread_cache() {
+            for (int32_t i = 0; i < class_count; ++i) {
+                free_block* b = lists[i].head;
+                while (b) {
+                    free_block* next = b->next;
+                    ::operator delete(b);
+                    b = next;
+                }
+                counters().parked_bytes -= (uint64_t)lists[i].count << (i + min_class_shift);
+                lists[i].head = nullptr;
+                lists[i].count = 0;
+            }
+            *destroyed = true;
+        }
+    };
+
+    struct atomic_stats {
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> parked_bytes;
+    };
+
+public:
+    /**
+     * @brief create a pooled buffer, the capacity is rounded up to the size class
+     */
+    static buffer_ptr create(int32_t size, bool auto_extend = false);
+
+    /**
+     * @brief allocate a block, size is rounded up to the size class
+     */
+    static void* allocate(int32_t& size) {
+        int32_t cls = size_class(size);
+        if (cls < 0) {
+            counters().misses.fetch_add(1, std::memory_order_relaxed);
+            return ::operator new(size);
+        }
+
+        size = class_size(cls);
+        thread_cache* cache = local_cache();
+        if (cache && cache->lists[cls].head) {
+            free_list& list = cache->lists[cls];
+            free_block* b = list.head;
+            list.head = b->next;
+            --list.count;
+
+            counters().hits.fetch_add(1, std::memory_order_relaxed);
+            counters().parked_bytes.fetch_sub(size, std::memory_order_relaxed);
+            return b;
+        }
+
+        counters().misses.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    /**
+     * @brief reclaim a block to the free list of the current thread
+     */
+    static void  reclaim(void* p, int32_t size) {
+        int32_t cls = size_class(size);
+        thread_cache* cache = cls < 0 ? nullptr : local_cache();
+        if (!cache || cache->lists[cls].count >= max_cached_count(cls)) {
+            ::operator delete(p);
+            return;
+        }
+
+        free_list& list = cache->lists[cls];
+        free_block* b = static_cast<free_block*>(p);
+        b->next = list.head;
+        list.head = b;
+        ++list.count;
+
+        counters().parked_bytes.fetch_add(class_size(cls), std::memory_order_relaxed);
+    }
+
+    static stats get_stats() {
+        stats s;
+        s.hits = counters().hits.load(std::memory_order_relaxed);
+        s.misses = counters().misses.load(std::memory_order_relaxed);
+        s.parked_bytes = counters().parked_bytes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    /**
+     * @brief return the size class of size, -1 when size is too large for the pool
+     */
+    static int32_t size_class(int32_t size) {
+        int32_t cls = 0;
+        while (class_size(cls) < size) {
+            if (++cls >= class_count) {
+                return -1;
+            }
+        }
+        return cls;
+    }
+
+    static int32_t class_size(int32_t cls) {
+        return 1 << (cls + min_class_shift);
+    }
+
+protected:
+    static uint32_t max_cached_count(int32_t cls) {
+        uint32_t count = max_cached_bytes_per_class >> (cls + min_class_shift);
+        return (std::max<uint32_t>)(count, min_cached_count_per_class);
+    }
+
+    static atomic_stats& counters() {
+        static atomic_stats s = { {0}, {0}, {0} };
+        return s;
+    }
+
+    static thread_cache* local_cache() {
+        // after the cache destructed(thread exiting) the blocks go to the global allocator directly
+        static thread_local bool destroyed = false;
+        if (destroyed) {
+            return nullptr;
+        }
+
+        static thread_local thread_cache cache(&destroyed);
+        return &cache;
+    }
+};
+
+/**
+ * @brief std allocator draw from the buffer pool, used by allocate_shared to
+ * recycle the control block together with the buffer object
+ */
+template<typename T>
+class buffer_pool_allocator
+{
+public:
+    typedef T value_type;
+
+    buffer_pool_allocator() {}
+
+    template<typename U>
+    buffer_pool_allocator(const buffer_pool_allocator<U>&) {}
+
+    template<typename U>
+    struct rebind {
+        typedef buffer_pool_allocator<U> other;
+    };
+
+    T* allocate(size_t n) {
+        int32_t size = (int32_t)(n * sizeof(T));
+        return static_cast<T*>(buffer_pool::allocate(size));
+    }
+
+    void deallocate(T* p, size_t n) {
+        buffer_pool::reclaim(p, (int32_t)(n * sizeof(T)));
+    }
+
+    template<typename U>
+    bool operator==(const buffer_pool_allocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const buffer_pool_allocator<U>&) const {
+        return false;
+    }
+};
+
+/**
+ * @brief buffer whose storage is drawn from the buffer pool
+ */
+class pooled_buffer : public buffer
+{
+public:
+    pooled_buffer(int32_t size, bool auto_extend = false)
+    {
+        is_auto_extend_ = auto_extend;
+        allocate(size);
+    }
+
+    virtual ~pooled_buffer(){
+        if (data_ && !is_wrappered_){
+            free_storage(data_, capacity_);
+            data_ = nullptr;
+        }
+    }
+
+protected:
+    virtual char* alloc_storage(int32_t& size) override
+    {
+        return static_cast<char*>(buffer_pool::allocate(size));
+    }
+
+    virtual void  free_storage(char* p, int32_t size) override
+    {
+        buffer_pool::reclaim(p, size);
+    }
+};
+
+inline buffer_ptr buffer_pool::create(int32_t size, bool auto_extend)
+{
+    return std::allocate_shared<pooled_buffer>(buffer_pool_allocator<pooled_buffer>(), size, auto_extend);
+}
+
+inline buffer_ptr make_pooled_buffer(int32_t size, bool auto_extend)
+{
+    return buffer_pool::create(size, auto_extend);
+}
+}
+
+#endif
@@ -0,0 +1,340 @@
+﻿/**
+ *
+ * buffer_slice.hpp
+ *
+ * a cheap read-only view over a range of a buffer, the slice shares the storage of
+ * the parent buffer through the buffer_ptr, copying a slice only bumps the refcount.
+ * each slice has its own reader index.
+ * the parent is pinned while slices are alive(it will not compact or grow, a write
+ * to an auto extend parent that needs to grow throws std::runtime_error), and
+ * the bytes under a slice should not be overwritten by the parent
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_buffer_slice_hpp__
+#define __utility_buffer_slice_hpp__
+
+#include "buffer.hpp"
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+
+namespace utility
+{
+class buffer_slice
+{
+protected:
+    buffer_ptr      parent_;
+    const char*     begin_;
+    int32_t         length_;
+    int32_t         reader_index_;
+    int32_t         reader_index_mark_;
+
+public:
+    buffer_slice()
+        : begin_(0)
+        , length_(0)
+        , reader_index_(0)
+        , reader_index_mark_(0)
+    {}
+
+    /**
+     * @brief slice length bytes at offset(relative to the parent's reader index) of parent
+     */
+    buffer_slice(const buffer_ptr& parent, int32_t offset, int32_t length)
+        : parent_(parent)
+        , begin_(0)
+        , length_(length)
+        , reader_index_(0)
+        , reader_index_mark_(0)
+    {
+        if (!parent_ || offset < 0 || length < 0 || offset + length > parent_->readable_bytes()){
+            throw std::runtime_error("buffer slice out of bounds.");
+        }
+
+        begin_ = parent_->data() + offset;
+        parent_->pin();
+    }
+
+    buffer_slice(const buffer_slice& other)
+        : parent_(other.parent_)
+        , begin_(other.begin_)
+        , length_(other.length_)
+        , reader_index_(other.reader_index_)
+        , reader_index_mark_(other.reader_index_mark_)
+    {
+        if (parent_){
+            parent_->pin();
+        }
+    }
+
+    buffer_slice(buffer_slice&& other)
+        : parent_(std::move(other.parent_))
+        , begin_(other.begin_)
+        , length_(other.length_)
+        , reader_index_(other.reader_index_)
+        , reader_index_mark_(other.reader_index_mark_)
+    {
+        other.reset();
+    }
+
+    buffer_slice& operator=(buffer_slice other){
+        swap(other);
+        return *this;
+    }
+
+    ~buffer_slice(){
+        if (parent_){
+            parent_->unpin();
+        }
+    }
+
+public:
+    void swap(buffer_slice& other){
+        std::swap(parent_, other.parent_);
+        std::swap(begin_, other.begin_);
+        std::swap(length_, other.length_);
+        std::swap(reader_index_, other.reader_index_);
+        std::swap(reader_index_mark_, other.reader_index_mark_);
+    }
+
+    /**
+     * @brief release the parent, the slice will be empty
+     */
+    void reset(){
+        if (parent_){
+            parent_->unpin();
+            parent_.reset();
+        }
+        begin_ = 0;
+        length_ = 0;
+        reader_index_ = 0;
+        reader_index_mark_ = 0;
+    }
+
+    /**
+     * @brief a sub slice of the readable bytes of this slice, shares the same parent
+     */
+    buffer_slice slice(int32_t offset, int32_t length){
+        if (offset < 0 || length < 0 || offset + length > readable_bytes()){
+            throw std::runtime_error("buffer slice out of bounds.");
+        }
+
+        buffer_slice s(*this);
+        s.begin_ = data() + offset;
+        s.length_ = length;
+        s.reader_index_ = 0;
+        s.reader_index_mark_ = 0;
+        return s;
+    }
+
+    /**
+     * @brief deep copy the readable bytes to a new buffer
+     */
+    buffer_ptr copy(){
+        buffer_ptr buf = buffer::create(readable_bytes());
+        buf->write_bytes(data(), readable_bytes());
+        return buf;
+    }
+
+    /**
+     * @brief copy-on-write escape hatch, return a writable buffer holding the readable
+     * bytes of the slice: when this slice is the only owner of the parent, the parent
+     * itself is returned without copying, otherwise the bytes are copied.
+     * the slice will be empty
+     */
+    buffer_ptr detach(){
+        buffer_ptr buf;
+        if (parent_ && parent_.use_count() == 1){
+            buf = parent_;
+            int32_t reader = (int32_t)(data() - (buf->data() - buf->reader_index()));
+            int32_t length = readable_bytes();
+            reset();
+            if (length > 0){
+                buf->set_write_index(reader + length);
+                buf->set_reader_index(reader);
+            }
+            else{
+                buf->clear();
+            }
+        }
+        else{
+            buf = copy();
+            reset();
+        }
+        return buf;
+    }
+
+    const buffer_ptr& parent(){
+        return parent_;
+    }
+
+    const char* data(){
+        return begin_ + reader_index_;
+    }
+
+    int32_t  drop_read(int32_t size){
+        int32_t to_drop_len = size;
+        if (to_drop_len > readable_bytes()){
+            to_drop_len = readable_bytes();
+        }
+
+        reader_index_ += to_drop_len;
+        return to_drop_len;
+    }
+
+    int32_t length(){
+        return length_;
+    }
+
+    int32_t readable_bytes(){
+        return length_ - reader_index_;
+    }
+
+    bool is_readable(){
+        return readable_bytes() > 0;
+    }
+
+    bool is_readable(int32_t size){
+        return readable_bytes() >= size;
+    }
+
+    void mark_reader_index(){
+        reader_index_mark_ = reader_index_;
+    }
+
+    void reset_reader_index(){
+        reader_index_ = reader_index_mark_;
+    }
+
+    int32_t reader_index(){
+        return reader_index_;
+    }
+
+    void    set_reader_index(int32_t index){
+        if (index >= 0 && index <= length_)
+            reader_index_ = index;
+        else
+            throw std::runtime_error("set reader index out of bounds");
+    }
+
+    char get_byte(int32_t index){
+        return begin_[index];
+    }
+
+    void get_bytes(int32_t index, char* dst, int32_t length){
+        memcpy(dst, begin_ + index, length);
+    }
+
+    int32_t read_bytes(char* dst, int32_t length){
+        int32_t to_read_len = length;
+        if (to_read_len > readable_bytes()){
+            to_read_len = readable_bytes();
+        }
+
+        memcpy(dst, data(), to_read_len);
+        reader_index_ += to_read_len;
+
+        return to_read_len;
+    }
+
+    int32_t read_bytes(buffer_ptr dst, int32_t length){
+        int32_t to_read_len = length;
+        if (to_read_len > readable_bytes()){
+            to_read_len = readable_bytes();
+        }
+
+        dst->write_bytes(data(), to_read_len);
+        reader_index_ += to_read_len;
+
+        return to_read_len;
+    }
+
+    /**
+     * @brief read length bytes as a sub slice, no copy
+     */
+    buffer_slice read_slice(int32_t length){
+        int32_t to_read_len = (std::min)(length, readable_bytes());
+        buffer_slice s = slice(0, to_read_len);
+        reader_index_ += to_read_len;
+        return s;
+    }
+
+    int8_t  read_int8(){
+        int8_t v;
+        read(v);
+        return v;
+    }
+
+    uint8_t read_uint8() {
+        uint8_t v;
+        read(v);
+        return v;
+    }
+
+    int16_t read_int16(){
+        int16_t v;
+        read(v);
+        return v;
+    }
+
+    uint16_t read_uint16() {
+        uint16_t v;
+        read(v);
+        return v;
+    }
+
+    int32_t read_int32(){
+        int32_t v;
+        read(v);
+        return v;
+    }
+
+    uint32_t read_uint32() {
+        uint32_t v;
+        read(v);
+        return v;
+    }
+
+    int64_t read_int64(){
+        int64_t v;
+        read(v);
+        return v;
+    }
+
+    uint64_t read_uint64() {
+        uint64_t v;
+        read(v);
+        return v;
+    }
+
+protected:
+    template<typename T>
+    void read(T& v){
+        read_bytes((char*)&v, sizeof(T));
+    }
+};
+
+/**
+ * @brief slice length bytes at offset(relative to the reader index) of buf, buf is not changed
+ */
+inline buffer_slice slice(const buffer_ptr& buf, int32_t offset, int32_t length)
+{
+    return buffer_slice(buf, offset, length);
+}
+
+/**
+ * @brief read length bytes of buf as a slice, the reader index of buf is advanced, no copy
+ */
+inline buffer_slice read_slice(const buffer_ptr& buf, int32_t length)
+{
+    int32_t to_read_len = (std::min)(length, buf->readable_bytes());
+    buffer_slice s(buf, 0, to_read_len);
+    buf->drop_read(to_read_len);
+    return s;
+}
+}
+
+#endif
@@ -0,0 +1,99 @@
+﻿/**
+ *
+ * circular_buffer.hpp
+ *
+ * a wrap-around buffer for the session receive loop, the storage is mapped twice
+ * back to back in the virtual memory(memfd double mapping), so the readable bytes
+ * are always contiguous and compact() only moves the indices instead of memmove the
+ * partial trailing frame. the read_* and write_* api is the same as buffer.
+ *
+ * the capacity is rounded up to the page size and the buffer does not auto extend.
+ * on the platforms without memfd it falls back to a normal(linear) buffer
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_circular_buffer_hpp__
+#define __utility_circular_buffer_hpp__
+
+#include "buffer.hpp"
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace utility
+{
+class circular_buffer : public buffer
+{
+public:
+    circular_buffer(int32_t size)
+    {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+        int32_t page = (int32_t)sysconf(_SC_PAGESIZE);
+        int32_t map_size = (std::max)((size + page - 1) / page * page, page);
+
+        data_ = map_twice(map_size);
+        if (data_){
+            capacity_ = map_size;
+            is_circular_ = true;
+            return;
+        }
+#endif
+        allocate(size);
+    }
+
+    static buffer_ptr create(int32_t size)
+    {
+        return std::make_shared<circular_buffer>(size);
+    }
+
+    virtual ~circular_buffer(){
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+        if (data_ && is_circular_){
+            munmap(data_, 2 * (size_t)capacity_);
+            data_ = nullptr;
+        }
+#endif
+    }
+
+    bool is_circular(){
+        return is_circular_;
+    }
+
+protected:
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    /**
+     * @brief reserve 2 * size of address space, then map the same memfd to both halves
+     */
+    static char* map_twice(int32_t size){
+        int fd = memfd_create("utility_circular_buffer", MFD_CLOEXEC);
+        if (fd < 0){
+            return nullptr;
+        }
+
+        char* addr = nullptr;
+        if (ftruncate(fd, size) == 0){
+            void* p = mmap(nullptr, 2 * (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED){
+                addr = (char*)p;
+                if (mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+                    mmap(addr + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED){
+                    munmap(addr, 2 * (size_t)size);
+                    addr = nullptr;
+                }
+            }
+        }
+
+        // the mappings keep the memory alive
+        close(fd);
+        return addr;
+    }
+#endif
+};
+}
+
+#endif
@@ -0,0 +1,206 @@
+﻿/**
+ *
+ * endian.hpp
+ *
+ * byte order helpers, swap single scalars and swap arrays in one pass
+ * (pshufb with AVX2/SSSE3 when the compiler targets them)
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_endian_hpp__
+#define __utility_endian_hpp__
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace utility
+{
+namespace endian
+{
+    inline bool is_little()
+    {
+        const uint16_t v = 1;
+        return *(const uint8_t*)&v == 1;
+    }
+
+    inline uint16_t swap16(uint16_t v)
+    {
+#if defined(_MSC_VER)
+        return _byteswap_ushort(v);
+#elif defined(__GNUC__)
+        return __builtin_bswap16(v);
+#else
+        return (uint16_t)((v >> 8) | (v << 8));
+#endif
+    }
+
+    inline uint32_t swap32(uint32_t v)
+    {
+#if defined(_MSC_VER)
+        return _byteswap_ulong(v);
+#elif defined(__GNUC__)
+        return __builtin_bswap32(v);
+#else
+        return (v >> 24) | ((v >> 8) & 0x0000ff00) | ((v << 8) & 0x00ff0000) | (v << 24);
+#endif
+    }
+
+    inline uint64_t swap64(uint64_t v)
+    {
+#if defined(_MSC_VER)
+        return _byteswap_uint64(v);
+#elif defined(__GNUC__)
+        return __builtin_bswap64(v);
+#else
+        return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+#endif
+    }
+
+    namespace detail
+    {
+        template<size_t Size>
+        struct swapper;
+
+        template<>
+        struct swapper<1> {
+            static void swap(void*) {}
+        };
+
+        template<>
+        struct swapper<2> {
+            static void swap(void* v) {
+                uint16_t t;
+                memcpy(&t, v, 2);
+                t = swap16(t);
+                memcpy(v, &t, 2);
+            }
+        };
+
+        template<>
+        struct swapper<4> {
+            static void swap(void* v) {
+                uint32_t t;
+                memcpy(&t, v, 4);
+                t = swap32(t);
+                memcpy(v, &t, 4);
+            }
+        };
+
+        template<>
+        struct swapper<8> {
+            static void swap(void* v) {
+                uint64_t t;
+                memcpy(&t, v, 8);
+                t = swap64(t);
+                memcpy(v, &t, 8);
+            }
+        };
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+        /**
+         * @brief the pshufb mask that reverse the bytes of each Size bytes element in 16 bytes
+         */
+        template<size_t Size>
+        inline __m128i shuffle_mask()
+        {
+            char m[16];
+            for (int i = 0; i < 16; ++i) {
+                m[i] = (char)((i / Size) * Size + (Size - 1 - i % Size));
+            }
+            return _mm_loadu_si128((const __m128i*)m);
+        }
+#endif
+    }
+
+    /**
+     * @brief reverse the byte order of a scalar(integer or floating point)
+     */
+    template<typename T>
+    inline T swap(T v)
+    {
+        detail::swapper<sizeof(T)>::swap(&v);
+        return v;
+    }
+
+    template<typename T>
+    inline T host_to_big(T v)
+    {
+        return is_little() ? swap(v) : v;
+    }
+
+    template<typename T>
+    inline T big_to_host(T v)
+    {
+        return is_little() ? swap(v) : v;
+    }
+
+    template<typename T>
+    inline T host_to_little(T v)
+    {
+        return is_little() ? v : swap(v);
+    }
+
+    template<typename T>
+    inline T little_to_host(T v)
+    {
+        return is_little() ? v : swap(v);
+    }
+
+    /**
+     * @brief copy count elements of Size bytes from src to dst and reverse the bytes
+     * of each element, dst and src may be unaligned, dst may equal src
+     */
+    template<size_t Size>
+    inline void swap_array(void* dst, const void* src, size_t count)
+    {
+        char* d = (char*)dst;
+        const char* s = (const char*)src;
+        size_t bytes = count * Size;
+        size_t i = 0;
+
+        if (Size == 1) {
+            if (d != s) {
+                memmove(d, s, bytes);
+            }
+            return;
+        }
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+        __m128i mask = detail::shuffle_mask<Size>();
+#if defined(__AVX2__)
+        __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+            _mm256_storeu_si256((__m256i*)(d + i), _mm256_shuffle_epi8(v, mask256));
+        }
+#endif
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+            _mm_storeu_si128((__m128i*)(d + i), _mm_shuffle_epi8(v, mask));
+        }
+#endif
+
+        for (; i < bytes; i += Size) {
+            char t[Size];
+            memcpy(t, s + i, Size);
+            detail::swapper<Size>::swap(t);
+            memcpy(d + i, t, Size);
+        }
+    }
+}
+}
+
+#endif
@@ -0,0 +1,242 @@
+﻿/**
+ *
+ * inline_function.hpp
+ *
+ * a move-only callable wrapper like std::function, the callable is stored in a
+ * fixed Capacity bytes buffer inside the object, so wrapping a small lambda never
+ * allocates. a callable larger than Capacity(or not nothrow movable) still works,
+ * it is moved to the heap. an empty std::function or a null function pointer makes
+ * an empty inline_function
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_inline_function_hpp__
+#define __ydk_utility_inline_function_hpp__
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+namespace utility
+{
+    template<class Signature, std::size_t Capacity = 48>
+    class inline_function;
+
+    template<class R, class... Args, std::size_t Capacity>
+    class inline_function<R(Args...), Capacity>
+    {
+        typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type storage_type;
+
+        struct ops
+        {
+            R       (*invoke)(void* storage, Args&&... args);
+            void    (*move)(void* dst, void* src);
+            void    (*destroy)(void* storage);
+        };
+
+        template<class F>
+        struct inline_ops
+        {
+            static R invoke(void* storage, Args&&... args)
+            {
+                return (*static_cast<F*>(storage))(std::forward<Args>(args)...);
+            }
+
+            static void move(void* dst, void* src)
+            {
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+            }
+
+            static void destroy(void* storage)
+            {
+                static_cast<F*>(storage)->~F();
+            }
+
+            static const ops* get()
+            {
+                static const ops o = { &invoke, &move, &destroy };
+                return &o;
+            }
+        };
+
+        template<class F>
+        struct heap_ops
+        {
+            static R invoke(void* storage, Args&&... args)
+            {
+                return (**static_cast<F**>(storage))(std::forward<Args>(args)...);
+            }
+
+            static void move(void* dst, void* src)
+            {
+                *static_cast<F**>(dst) = *static_cast<F**>(src);
+            }
+
+            static void destroy(void* storage)
+            {
+                delete *static_cast<F**>(storage);
+            }
+
+            static const ops* get()
+            {
+                static const ops o = { &invoke, &move, &destroy };
+                return &o;
+            }
+        };
+
+    public:
+        /**
+         * @brief whether F is stored inline(without heap allocation)
+         */
+        template<class F>
+        struct fits
+        {
+            static const bool value = sizeof(F) <= Capacity
+                && alignof(F) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<F>::value;
+        };
+
+        inline_function()
+            :ops_(nullptr)
+        {
+        }
+
+        inline_function(std::nullptr_t)
+            :ops_(nullptr)
+        {
+        }
+
+        template<class F, class = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, inline_function>::value>::type>
+        inline_function(F&& f)
+            :ops_(nullptr)
+        {
+            assign(std::forward<F>(f));
+        }
+
+        inline_function(inline_function&& other)
+            :ops_(nullptr)
+        {
+            move_from(other);
+        }
+
+        inline_function(const inline_function&) = delete;
+        inline_function& operator=(const inline_function&) = delete;
+
+        ~inline_function()
+        {
+            reset();
+        }
+
+        inline_function& operator=(inline_function&& other)
+        {
+            if (this != &other){
+                reset();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        inline_function& operator=(std::nullptr_t)
+        {
+            reset();
+            return *this;
+        }
+
+        template<class F, class = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, inline_function>::value>::type>
+        inline_function& operator=(F&& f)
+        {
+            reset();
+            assign(std::forward<F>(f));
+            return *this;
+        }
+
+        /**
+         * @brief throw std::bad_function_call when empty, as std::function does
+         */
+        R operator()(Args... args) const
+        {
+            if (!ops_){
+                throw std::bad_function_call();
+            }
+            return ops_->invoke(const_cast<storage_type*>(&storage_), std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const
+        {
+            return ops_ != nullptr;
+        }
+
+        void reset()
+        {
+            if (ops_){
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+
+    private:
+        template<class F>
+        void assign(F&& f)
+        {
+            typedef typename std::decay<F>::type functor_type;
+            if (is_null(f)){
+                return;
+            }
+            assign_impl<functor_type>(std::forward<F>(f), std::integral_constant<bool, fits<functor_type>::value>());
+        }
+
+        template<class F>
+        static bool is_null(const F&)
+        {
+            return false;
+        }
+
+        template<class F>
+        static bool is_null(F* f)
+        {
+            return f == nullptr;
+        }
+
+        template<class Signature>
+        static bool is_null(const std::function<Signature>& f)
+        {
+            return !f;
+        }
+
+        template<class T, class F>
+        void assign_impl(F&& f, std::true_type)
+        {
+            new (&storage_) T(std::forward<F>(f));
+            ops_ = inline_ops<T>::get();
+        }
+
+        template<class T, class F>
+        void assign_impl(F&& f, std::false_type)
+        {
+            *reinterpret_cast<T**>(&storage_) = new T(std::forward<F>(f));
+            ops_ = heap_ops<T>::get();
+        }
+
+        void move_from(inline_function& other)
+        {
+            if (other.ops_){
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+
+    private:
+        storage_type    storage_;
+        const ops*      ops_;
+    };
+}
+
+#endif
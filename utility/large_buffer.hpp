@@ -0,0 +1,387 @@
+﻿/**
+ *
+ * large_buffer.hpp
+ *
+ * a buffer for large blobs(e.g. snapshot), 64-bit indices and no max_buffer_size limit,
+ * on linux the storage is an anonymous mmap which grows with mremap, the pages are
+ * remapped instead of copied, so growing need no memcpy and no doubled peak memory.
+ * the reader and writer indices are kept when the storage grows
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_large_buffer_hpp__
+#define __utility_large_buffer_hpp__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace utility
+{
+class large_buffer;
+typedef std::shared_ptr<large_buffer> large_buffer_ptr;
+class large_buffer
+{
+protected:
+    char*   data_;
+    int64_t capacity_;
+    int64_t max_capacity_;
+    int64_t reader_index_;
+    int64_t writer_index_;
+    int64_t reader_index_mark_;
+
+public:
+    /**
+     * @brief
+     * @param size:         initial capacity, rounded up to the page size
+     * @param max_capacity: the max capacity the buffer can grow to, 0 means no limit,
+     *                      throw std::runtime_error when size exceeds it
+     */
+    large_buffer(int64_t size, int64_t max_capacity = 0)
+        : data_(0)
+        , capacity_(0)
+        , max_capacity_(max_capacity)
+        , reader_index_(0)
+        , writer_index_(0)
+        , reader_index_mark_(0)
+    {
+        if (!reserve(size)){
+            char error[128];
+            sprintf(error, "large buffer initial size exceeds the max capacity [%lldB > %lldB].",
+                (long long)size, (long long)max_capacity);
+            throw std::runtime_error(error);
+        }
+    }
+
+    static large_buffer_ptr create(int64_t size, int64_t max_capacity = 0)
+    {
+        return std::make_shared<large_buffer>(size, max_capacity);
+    }
+
+    virtual ~large_buffer(){
+        if (data_){
+            unmap(data_, capacity_);
+            data_ = nullptr;
+        }
+    }
+
+private:
+    large_buffer(const large_buffer&);
+    large_buffer& operator=(const large_buffer&);
+
+public:
+    char* data(){
+        return data_ + reader_index_;
+    }
+
+    int64_t  drop_read(int64_t size){
+        int64_t to_drop_len = size;
+        if (reader_index_ + size > writer_index_){
+            to_drop_len = writer_index_ - reader_index_;
+        }
+
+        reader_index_ += to_drop_len;
+        return to_drop_len;
+    }
+
+    int64_t drop_write(int64_t size){
+        int64_t to_drop_len = size;
+        if (writer_index_ - size < reader_index_){
+            to_drop_len = writer_index_ - reader_index_;
+        }
+        writer_index_ -= to_drop_len;
+        return to_drop_len;
+    }
+
+    int64_t max_capacity(){
+        return capacity_;
+    }
+
+    int64_t capacity(){
+        return capacity_ - writer_index_;
+    }
+
+    int64_t readable_bytes(){
+        return writer_index_ - reader_index_;
+    }
+
+    bool is_readable(){
+        return readable_bytes() > 0;
+    }
+
+    bool is_readable(int64_t size){
+        return readable_bytes() >= size;
+    }
+
+    void mark_reader_index(){
+        reader_index_mark_ = reader_index_;
+    }
+
+    void reset_reader_index(){
+        reader_index_ = reader_index_mark_;
+    }
+
+    int64_t reader_index(){
+        return reader_index_;
+    }
+
+    void    set_reader_index(int64_t index){
+        if (index >= 0 && index < capacity_)
+            reader_index_ = index;
+        else
+            throw std::runtime_error("set reader index out of bounds");
+    }
+
+    void    clear(){
+        reader_index_ = 0;
+        writer_index_ = 0;
+        reader_index_mark_ = 0;
+    }
+
+    bool    is_writable(){
+        return capacity() > 0;
+    }
+
+    bool    is_writable(int64_t size){
+        return capacity() >= size;
+    }
+
+    void    set_write_index(int64_t index){
+        if (index >= 0 && index <= capacity_)
+            writer_index_ = index;
+        else
+            throw std::runtime_error("set write index out of bounds.");
+    }
+
+    int64_t writer_index(){
+        return writer_index_;
+    }
+
+    char get_byte(int64_t index){
+        return data_[index];
+    }
+
+    void get_bytes(int64_t index, char* dst, int64_t length){
+        memcpy(dst, data_ + index, length);
+    }
+
+    void set_byte(int64_t index, char b){
+        data_[index] = b;
+    }
+
+    void set_bytes(int64_t index, char* src, int64_t length){
+        memcpy(data_ + index, src, length);
+    }
+
+    int64_t read_bytes(char* dst, int64_t length){
+        int64_t to_read_len = length;
+        if (to_read_len > readable_bytes()){
+            to_read_len = readable_bytes();
+        }
+
+        memcpy(dst, data(), to_read_len);
+        reader_index_ += to_read_len;
+
+        return to_read_len;
+    }
+
+    int8_t  read_int8(){
+        int8_t v;
+        read(v);
+        return v;
+    }
+
+    uint8_t read_uint8() {
+        uint8_t v;
+        read(v);
+        return v;
+    }
+
+    int16_t read_int16(){
+        int16_t v;
+        read(v);
+        return v;
+    }
+
+    uint16_t read_uint16() {
+        uint16_t v;
+        read(v);
+        return v;
+    }
+
+    int32_t read_int32(){
+        int32_t v;
+        read(v);
+        return v;
+    }
+
+    uint32_t read_uint32() {
+        uint32_t v;
+        read(v);
+        return v;
+    }
+
+    int64_t read_int64(){
+        int64_t v;
+        read(v);
+        return v;
+    }
+
+    uint64_t read_uint64() {
+        uint64_t v;
+        read(v);
+        return v;
+    }
+
+    bool write_bytes(const char* data, int64_t len){
+        if (capacity() < len){
+            if (!reserve(writer_index_ + len)){
+                return false;
+            }
+        }
+
+        memcpy(data_ + writer_index_, data, len);
+        writer_index_ += len;
+        return true;
+    }
+
+    bool write_int8(int8_t v){
+        return write(v);
+    }
+
+    bool write_uint8(uint8_t v) {
+        return write(v);
+    }
+
+    bool write_int16(int16_t v){
+        return write(v);
+    }
+
+    bool write_uint16(uint16_t v) {
+        return write(v);
+    }
+
+    bool write_int32(int32_t v){
+        return write(v);
+    }
+
+    bool write_uint32(uint32_t v) {
+        return write(v);
+    }
+
+    bool write_int64(int64_t v){
+        return write(v);
+    }
+
+    bool write_uint64(uint64_t v) {
+        return write(v);
+    }
+
+    void compact(){
+        if (reader_index_ > 0){
+            memmove(data_, data(), readable_bytes());
+            writer_index_ = readable_bytes();
+            reader_index_ = 0;
+        }
+    }
+
+    /**
+     * @brief make sure the total capacity is at least size, the storage grows
+     * at least by double(rounded up to the page size), the indices are kept
+     * @return false when exceeding the max capacity
+     */
+    bool    reserve(int64_t size){
+        if (size <= capacity_ && data_){
+            return true;
+        }
+
+        int64_t new_capacity = (std::max<int64_t>)(capacity_ * 2, size);
+        new_capacity = round_up(new_capacity);
+        if (max_capacity_ > 0 && new_capacity > max_capacity_){
+            if (size > max_capacity_){
+                return false;
+            }
+            new_capacity = size;
+        }
+
+        char* new_data = data_ ? remap(data_, capacity_, new_capacity) : map(new_capacity);
+        if (!new_data){
+            char error[128];
+            sprintf(error, "large buffer allocate memory failed [%lldB].", (long long)new_capacity);
+            throw std::runtime_error(error);
+        }
+
+        data_ = new_data;
+        capacity_ = new_capacity;
+        return true;
+    }
+
+protected:
+    template<typename T>
+    void read(T& v){
+        read_bytes((char*)&v, sizeof(T));
+    }
+
+    template<typename T>
+    bool write(T v){
+        return write_bytes((char*)&v, sizeof(T));
+    }
+
+    static int64_t page_size(){
+#if defined(__linux__)
+        static const int64_t size = sysconf(_SC_PAGESIZE);
+        return size;
+#else
+        return 4096;
+#endif
+    }
+
+    static int64_t round_up(int64_t size){
+        int64_t page = page_size();
+        return (std::max<int64_t>)((size + page - 1) / page * page, page);
+    }
+
+#if defined(__linux__)
+    static char* map(int64_t size){
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return p == MAP_FAILED ? nullptr : (char*)p;
+    }
+
+    static char* remap(char* p, int64_t old_size, int64_t new_size){
+        void* n = mremap(p, old_size, new_size, MREMAP_MAYMOVE);
+        return n == MAP_FAILED ? nullptr : (char*)n;
+    }
+
+    static void  unmap(char* p, int64_t size){
+        munmap(p, size);
+    }
+#else
+    static char* map(int64_t size){
+        return (char*)malloc(size);
+    }
+
+    static char* remap(char* p, int64_t old_size, int64_t new_size){
+        (void)old_size;
+        return (char*)realloc(p, new_size);
+    }
+
+    static void  unmap(char* p, int64_t size){
+        (void)size;
+        free(p);
+    }
+#endif
+};
+}
+
+#endif
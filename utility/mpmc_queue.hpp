@@ -0,0 +1,200 @@
+/**
+ *
+ * a bounded lock-free mpmc queue(multi producers, multi consumers)
+ *
+ * each cell carries a sequence number which tells whether the cell is ready for
+ * the producer of the lap or for the consumer of the lap(Dmitry Vyukov's bounded mpmc queue),
+ * producers and consumers only contend on their own position counter.
+ * the cell count is rounded up to a power of two.
+ *
+ * push/pop have the same shape as ring_buffer and never block(return false when full/empty),
+ * wait_push/wait_pop spin and then yield until they succeed
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_mpmc_queue_hpp__
+#define __ydk_utility_mpmc_queue_hpp__
+
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <utility>
+#include <type_traits>
+#include <utility/noncopyable.hpp>
+#include <utility/ring_buffer.hpp>
+
+namespace utility{
+
+template<class T, uint32_t N>
+class mpmc_queue : public noncopyable{
+    static_assert(N > 1 && N <= 0x80000000u, "mpmc_queue size out of range");
+
+protected:
+    enum { cache_line_size = 64, spin_count = 64 };
+
+    static const uint32_t buffer_size = details::round_up_pow2(N);
+    static const uint32_t buffer_mask = buffer_size - 1;
+
+    struct cell {
+        std::atomic<uint32_t>                                           sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type      storage;
+
+        T* value(){
+            return reinterpret_cast<T*>(&storage);
+        }
+    };
+
+    alignas(cache_line_size) std::atomic<uint32_t>  enqueue_pos_;
+    alignas(cache_line_size) std::atomic<uint32_t>  dequeue_pos_;
+    alignas(cache_line_size) cell                   cells_[buffer_size];
+
+public:
+    mpmc_queue() :enqueue_pos_(0), dequeue_pos_(0){
+        for (uint32_t i = 0; i < buffer_size; ++i){
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~mpmc_queue(){
+        uint32_t h = dequeue_pos_.load(std::memory_order_relaxed);
+        uint32_t t = enqueue_pos_.load(std::memory_order_relaxed);
+        for (; h != t; ++h){
+            cells_[h & buffer_mask].value()->~T();
+        }
+    }
+
+    bool empty(){
+        return size() == 0;
+    }
+
+    bool full(){
+        return size() >= buffer_size;
+    }
+
+    /**
+     * @brief approximate element count, exact only when the queue is quiet
+     */
+    uint32_t size(){
+        uint32_t t = enqueue_pos_.load(std::memory_order_acquire);
+        uint32_t h = dequeue_pos_.load(std::memory_order_acquire);
+        return (int32_t)(t - h) > 0 ? t - h : 0;
+    }
+
+    /**
+     * @brief the real capacity, N rounded up to a power of two. unlike ring_buffer, which
+     * holds at most N elements, the queue does not cap the count at N since that would
+     * need a size check on every push
+     */
+    uint32_t max_size(){
+        return buffer_size;
+    }
+
+    /**
+     * @brief construct the element in place
+     * @return false when the queue is full
+     */
+    template<typename... Args>
+    bool emplace(Args&&... args){
+        cell* c = nullptr;
+        uint32_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;){
+            c = &cells_[pos & buffer_mask];
+            uint32_t seq = c->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0){
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if (diff < 0){
+                // the consumer of the previous lap has not taken the cell, full
+                return false;
+            }
+            else{
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (c->value()) T(std::forward<Args>(args)...);
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& v){
+        return emplace(v);
+    }
+
+    bool push(T&& v){
+        return emplace(std::move(v));
+    }
+
+    /**
+     * @brief move the element at the head to v
+     * @return false when the queue is empty
+     */
+    bool pop(T& v){
+        cell* c = nullptr;
+        uint32_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;){
+            c = &cells_[pos & buffer_mask];
+            uint32_t seq = c->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - (pos + 1));
+            if (diff == 0){
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if (diff < 0){
+                // the producer of the lap has not filled the cell, empty
+                return false;
+            }
+            else{
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* p = c->value();
+        v = std::move(*p);
+        p->~T();
+        c->sequence.store(pos + buffer_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief blocking push, spin and then yield until there is a free cell
+     */
+    void wait_push(const T& v){
+        for (uint32_t i = 0; !push(v); ++i){
+            backoff(i);
+        }
+    }
+
+    void wait_push(T&& v){
+        for (uint32_t i = 0; !emplace(std::move(v)); ++i){
+            backoff(i);
+        }
+    }
+
+    /**
+     * @brief blocking pop, spin and then yield until there is an element
+     */
+    void wait_pop(T& v){
+        for (uint32_t i = 0; !pop(v); ++i){
+            backoff(i);
+        }
+    }
+
+protected:
+    static void backoff(uint32_t i){
+        if (i >= spin_count){
+            std::this_thread::yield();
+        }
+    }
+};
+
+} // end namespace utility
+
+#endif
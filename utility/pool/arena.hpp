@@ -0,0 +1,452 @@
+﻿/**
+ *
+ * arena.hpp
+ *
+ * a monotonic(bump pointer) arena for the short-lived objects which die together,
+ * e.g. the scratch of one request: allocate just moves a pointer inside the current
+ * chunk, deallocate does nothing, and reset()/rewind() release everything at once.
+ * the chunks are kept for reuse after reset, they come from malloc or are borrowed
+ * from a memory_pool whose cell is one chunk
+ *
+ * the arena does not run any destructor and is not thread safe, use one arena per
+ * request(or per thread)
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_arena_hpp__
+#define __ydk_utility_pool_arena_hpp__
+
+#include "memory_pool.hpp"
+#include <utility/noncopyable.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <mutex>
+#include <utility>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define UTILITY_ARENA_HAS_PMR 1
+#endif
+#endif
+
+namespace utility
+{
+    /**
+     * @brief
+     * monotonic arena, Mutex is the mutex of the memory_pool lending the chunks,
+     * the arena itself never locks
+     */
+    template<class Mutex = std::mutex>
+    class arena : public utility::noncopyable
+    {
+    public:
+        typedef uint32_t                size_type;
+        typedef memory_pool<Mutex>      chunk_pool_type;
+
+        enum
+        {
+            default_chunk_size = 4096,
+        };
+
+    private:
+        struct chunk_header
+        {
+            chunk_header*   next;
+            size_type       size;           // the usable bytes after the header
+            bool            from_pool;
+        };
+
+        enum
+        {
+            max_align = alignof(std::max_align_t),
+            header_size = (sizeof(chunk_header) + max_align - 1) / max_align * max_align,
+        };
+
+    public:
+        /**
+         * @brief the allocation position, rewind() to it frees everything allocated after mark()
+         */
+        struct marker
+        {
+            chunk_header*   chunk;
+            char*           ptr;
+            size_t          used_bytes;
+        };
+
+        /**
+         * @brief
+         * @param chunk_size:   the usable bytes of each malloc chunk
+         */
+        explicit arena(size_type chunk_size = default_chunk_size)
+            :m_chunk_pool(nullptr)
+            ,m_chunk_size(chunk_size > 0 ? chunk_size : (size_type)default_chunk_size)
+        {
+            init();
+        }
+
+        /**
+         * @brief
+         * @param chunk_pool:   borrow the chunks from the pool, each cell is one chunk,
+         *                      the pool must outlive the arena
+         */
+        explicit arena(chunk_pool_type& chunk_pool)
+            :m_chunk_pool(&chunk_pool)
+            ,m_chunk_size(chunk_pool.cell_size() > header_size ? chunk_pool.cell_size() - (size_type)header_size : 0)
+        {
+            init();
+        }
+
+        ~arena()
+        {
+            release();
+        }
+
+        /**
+         * @brief bump allocate size bytes aligned to align(a power of two)
+         */
+        void*   allocate(size_t size, size_t align = alignof(std::max_align_t))
+        {
+            char* p = align_up(m_ptr, align);
+            if( !m_current || p + size > m_end || p < m_ptr )
+            {
+                p = next_chunk(size, align);
+            }
+
+            m_ptr = p + size;
+            m_used_bytes += size;
+            return p;
+        }
+
+        /**
+         * @brief construct an object in the arena, its destructor will never be called
+         */
+        template<typename T, typename... Args>
+        T*      create(Args&&... args)
+        {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief uninitialized storage of count T
+         */
+        template<typename T>
+        T*      allocate_array(size_t count)
+        {
+            return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        /**
+         * @brief O(1), forget all the allocations and keep the chunks for reuse
+         */
+        void    reset()
+        {
+            m_current = nullptr;
+            m_ptr = nullptr;
+            m_end = nullptr;
+            m_used_bytes = 0;
+        }
+
+        marker  mark() const
+        {
+            marker m;
+            m.chunk = m_current;
+            m.ptr = m_ptr;
+            m.used_bytes = m_used_bytes;
+            return m;
+        }
+
+        /**
+         * @brief O(1), free everything allocated after m was taken, the markers must be
+         * rewound in the reverse order they were taken
+         */
+        void    rewind(const marker& m)
+        {
+            m_current = m.chunk;
+            m_ptr = m.ptr;
+            m_end = m_current ? chunk_data(m_current) + m_current->size : nullptr;
+            m_used_bytes = m.used_bytes;
+        }
+
+        /**
+         * @brief return all the chunks to malloc/the chunk pool
+         */
+        void    release()
+        {
+            chunk_header* chunk = m_head;
+            while( chunk )
+            {
+                chunk_header* next = chunk->next;
+                free_chunk(chunk);
+                chunk = next;
+            }
+            m_head = nullptr;
+            m_chunk_count = 0;
+            m_reserved_bytes = 0;
+            reset();
+        }
+
+        /**
+         * @brief the bytes allocated since the last reset, without the alignment padding
+         */
+        inline  size_t  used_bytes() const
+        {
+            return m_used_bytes;
+        }
+
+        /**
+         * @brief the usable bytes of all the chunks held
+         */
+        inline  size_t  reserved_bytes() const
+        {
+            return m_reserved_bytes;
+        }
+
+        inline  size_type chunk_count() const
+        {
+            return m_chunk_count;
+        }
+
+    private:
+        void    init()
+        {
+            m_head = nullptr;
+            m_chunk_count = 0;
+            m_reserved_bytes = 0;
+            reset();
+        }
+
+        static char*    align_up(char* p, size_t align)
+        {
+            return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        static char*    chunk_data(chunk_header* chunk)
+        {
+            return reinterpret_cast<char*>(chunk) + header_size;
+        }
+
+        /**
+         * @brief move to the next kept chunk, or link a new one after the current chunk
+         * when the next one can not hold the allocation
+         */
+        char*   next_chunk(size_t size, size_t align)
+        {
+            size_t need = size + (align > (size_t)max_align ? align : 0);
+
+            chunk_header* next = m_current ? m_current->next : m_head;
+            if( !next || next->size < need )
+            {
+                next = new_chunk(need);
+                if( m_current )
+                {
+                    next->next = m_current->next;
+                    m_current->next = next;
+                }
+                else
+                {
+                    next->next = m_head;
+                    m_head = next;
+                }
+            }
+
+            m_current = next;
+            m_end = chunk_data(next) + next->size;
+            return align_up(chunk_data(next), align);
+        }
+
+        chunk_header*   new_chunk(size_t need)
+        {
+            chunk_header* chunk = nullptr;
+            if( m_chunk_pool && need <= m_chunk_size )
+            {
+                chunk = static_cast<chunk_header*>(m_chunk_pool->allocate());
+                chunk->size = m_chunk_size;
+                chunk->from_pool = true;
+            }
+            else
+            {
+                size_type size = need > m_chunk_size ? (size_type)need : m_chunk_size;
+                chunk = static_cast<chunk_header*>(malloc(header_size + size));
+                if( !chunk )
+                {
+                    throw std::bad_alloc();
+                }
+                chunk->size = size;
+                chunk->from_pool = false;
+            }
+
+            chunk->next = nullptr;
+            ++ m_chunk_count;
+            m_reserved_bytes += chunk->size;
+            return chunk;
+        }
+
+        void    free_chunk(chunk_header* chunk)
+        {
+            if( chunk->from_pool )
+            {
+                m_chunk_pool->reclaim(chunk);
+            }
+            else
+            {
+                free(chunk);
+            }
+        }
+
+    private:
+        chunk_pool_type*    m_chunk_pool;       // 借用内存块的内存池(可为空)
+
+        size_type           m_chunk_size;       // 每个内存块的可用大小
+
+        chunk_header*       m_head;             // 内存块链表
+
+        chunk_header*       m_current;          // 当前分配的内存块
+
+        char*               m_ptr;              // 当前分配位置
+
+        char*               m_end;              // 当前内存块的结束位置
+
+        size_t              m_used_bytes;       // 已分配的字节数
+
+        size_t              m_reserved_bytes;   // 所有内存块的可用字节数
+
+        size_type           m_chunk_count;      // 内存块数
+    };
+
+    /**
+     * @brief
+     * rewind the arena to where it was at construction, the guards can be stacked,
+     * e.g. one per request and one per nested step
+     */
+    template<class Arena>
+    class scoped_arena : public utility::noncopyable
+    {
+    public:
+        explicit scoped_arena(Arena& a)
+            :m_arena(a)
+            ,m_marker(a.mark())
+        {
+        }
+
+        ~scoped_arena()
+        {
+            m_arena.rewind(m_marker);
+        }
+
+        Arena&  get()
+        {
+            return m_arena;
+        }
+
+    private:
+        Arena&                      m_arena;
+        typename Arena::marker      m_marker;
+    };
+
+    /**
+     * @brief std allocator over an arena, deallocate does nothing
+     */
+    template<typename T, class Arena = arena<> >
+    class arena_allocator
+    {
+    public:
+        typedef T               value_type;
+        typedef T*              pointer;
+        typedef const T*        const_pointer;
+        typedef T&              reference;
+        typedef const T&        const_reference;
+        typedef size_t          size_type;
+        typedef ptrdiff_t       difference_type;
+
+        template<typename U>
+        struct rebind
+        {
+            typedef arena_allocator<U, Arena> other;
+        };
+
+        explicit arena_allocator(Arena& a)
+            :m_arena(&a)
+        {
+        }
+
+        template<typename U>
+        arena_allocator(const arena_allocator<U, Arena>& other)
+            :m_arena(other.get_arena())
+        {
+        }
+
+        T*      allocate(size_t n)
+        {
+            return m_arena->template allocate_array<T>(n);
+        }
+
+        void    deallocate(T*, size_t)
+        {
+        }
+
+        Arena*  get_arena() const
+        {
+            return m_arena;
+        }
+
+        template<typename U>
+        bool    operator==(const arena_allocator<U, Arena>& other) const
+        {
+            return m_arena == other.get_arena();
+        }
+
+        template<typename U>
+        bool    operator!=(const arena_allocator<U, Arena>& other) const
+        {
+            return m_arena != other.get_arena();
+        }
+
+    private:
+        Arena*  m_arena;
+    };
+
+#ifdef UTILITY_ARENA_HAS_PMR
+    /**
+     * @brief std::pmr::memory_resource over an arena, the arena must outlive the resource users
+     */
+    template<class Arena = arena<> >
+    class arena_memory_resource : public std::pmr::memory_resource
+    {
+    public:
+        explicit arena_memory_resource(Arena& a)
+            :m_arena(a)
+        {
+        }
+
+        Arena&  get_arena()
+        {
+            return m_arena;
+        }
+
+    protected:
+        virtual void*   do_allocate(size_t bytes, size_t alignment) override
+        {
+            return m_arena.allocate(bytes, alignment);
+        }
+
+        virtual void    do_deallocate(void*, size_t, size_t) override
+        {
+        }
+
+        virtual bool    do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        Arena&  m_arena;
+    };
+#endif
+}
+
+#endif
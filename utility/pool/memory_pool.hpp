@@ -12,9 +12,15 @@
 #define __ydk_utility_pool_memory_pool_hpp__
 
 #include <cstdint>
-#include <list>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include "pool_trim.hpp"
+#include "slab.hpp"
 
 namespace utility
 {
@@ -22,25 +28,40 @@ namespace utility
      * @brief 
      * memory pool, try to decrease the cost that allocate memory and free memory
      * try to reuse the object memory as far as possible
+     *
+     * the pool grows by one contiguous chunk of grow_cell_count cells, and the free
+     * cells are linked through the cells themselves, so allocate/reclaim never
+     * allocate any bookkeeping memory
      */
     template<class Mutex>
     class memory_pool
     {
     public:
 
-        typedef uint32_t            size_type;
-        typedef void*               pointer;
-        typedef std::list<pointer>  cell_queue_type;
+        typedef uint32_t                size_type;
+        typedef void*                   pointer;
+        typedef Mutex                   mutex_type;
+        typedef std::vector<details::pool_chunk>    chunk_array_type;
 
         /** 
          * @brief
          * @param cell_size:            each cell's meory size
          * @param initial_cell_count:   initial cell count
          * @param grow_cell_count:      the memory pool infate speed
+         * @param options:              the chunk backing, with huge pages a chunk is rounded up
+         *                              to whole 2MB pages and filled with cells
          */
-        memory_pool(size_type cell_size, size_type initial_cell_count, size_type grow_cell_count = 1)
+        memory_pool(size_type cell_size, size_type initial_cell_count, size_type grow_cell_count = 1,
+            const slab_options& options = slab_options())
             :m_cell_size(cell_size)
-            ,m_grow_cell_count(grow_cell_count)
+            ,m_stride(stride_of(cell_size))
+            ,m_grow_cell_count(grow_cell_count > 0 ? grow_cell_count : 1)
+            ,m_free_head(nullptr)
+            ,m_free_cell_count(0)
+            ,m_total_cell_count(0)
+            ,m_peak_used_cell_count(0)
+            ,m_slab_options(options)
+            ,m_backing(slab_backing_heap)
         {
             inflate(initial_cell_count);
         }
@@ -57,13 +78,32 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            auto iter = m_total_cells.begin();
-            for( iter; iter != m_total_cells.end(); ++ iter )
+            auto iter = m_chunks.begin();
+            for( ; iter != m_chunks.end(); ++ iter )
             {
-                free(*iter);
+                slab::free(iter->base, (size_t)iter->count * m_stride, m_slab_options);
             }
-            m_total_cells.clear();
-            m_free_cells.clear();
+            m_chunks.clear();
+            m_free_head = nullptr;
+            m_free_cell_count = 0;
+            m_total_cell_count = 0;
+        }
+
+        /** 
+         * @brief
+         * return the chunks whose cells are all free to the system, while at least
+         * keep_free_cells free cells are left
+         * @return the bytes released
+         */
+        size_t  trim(size_type keep_free_cells = 0)
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            size_type released = details::trim_chunks(m_chunks, m_free_head, m_free_cell_count, keep_free_cells,
+                [this](const details::pool_chunk& chunk){ slab::free(chunk.base, (size_t)chunk.count * m_stride, m_slab_options); });
+            m_free_cell_count -= released;
+            m_total_cell_count -= released;
+            return (size_t)released * m_stride;
         }
 
         /** 
@@ -73,13 +113,15 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            if( m_free_cells.empty())
+            if( !m_free_head )
             {
                 inflate(m_grow_cell_count);
             }
 
-            pointer ret = m_free_cells.front();
-            m_free_cells.pop_front();
+            free_cell* ret = m_free_head;
+            m_free_head = ret->next;
+            -- m_free_cell_count;
+            update_peak();
 
             return ret;
         }
@@ -91,7 +133,55 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            m_free_cells.push_back(p);
+            free_cell* cell = static_cast<free_cell*>(p);
+            cell->next = m_free_head;
+            m_free_head = cell;
+            ++ m_free_cell_count;
+        }
+
+        /** 
+         * allocate count cells to cells with one lock
+         */
+        void    allocate_n(pointer* cells, size_type count)
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            for( size_type i = 0; i < count; ++ i )
+            {
+                if( !m_free_head )
+                {
+                    inflate(m_grow_cell_count > count - i ? m_grow_cell_count : count - i);
+                }
+
+                cells[i] = m_free_head;
+                m_free_head = m_free_head->next;
+            }
+            m_free_cell_count -= count;
+            update_peak();
+        }
+
+        /** 
+         * reclaim count cells with one lock
+         */
+        void    reclaim_n(pointer* cells, size_type count)
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            for( size_type i = 0; i < count; ++ i )
+            {
+                free_cell* cell = static_cast<free_cell*>(cells[i]);
+                cell->next = m_free_head;
+                m_free_head = cell;
+            }
+            m_free_cell_count += count;
+        }
+
+        /** 
+         * @brief get each cell's memory size
+         */
+        inline  size_type cell_size()
+        {
+            return m_cell_size;
         }
 
         /** 
@@ -101,7 +191,7 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_free_cells.size();
+            return m_free_cell_count;
         }
 
         /** 
@@ -111,7 +201,7 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_free_cells.size() * m_cell_size;
+            return m_free_cell_count * m_cell_size;
         }
 
         /** 
@@ -121,7 +211,7 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_total_cells.size();
+            return m_total_cell_count;
         }
 
         /** 
@@ -131,43 +221,139 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_total_cells.size() * m_cell_size;
+            return m_total_cell_count * m_cell_size;
+        }
+
+        /** 
+         * @brief get the count of the cells in use
+         */
+        inline  size_type   used_cell_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_total_cell_count - m_free_cell_count;
+        }
+
+        /** 
+         * @brief get the max count of the cells in use at the same time
+         */
+        inline  size_type   peak_used_cell_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_peak_used_cell_count;
+        }
+
+        /** 
+         * @brief get the count of the chunks held
+         */
+        inline  size_type   chunk_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return (size_type)m_chunks.size();
+        }
+
+        /** 
+         * @brief get the backing obtained for the latest chunk
+         */
+        inline  slab_backing    backing()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_backing;
         }
 
     private:
 
+        struct free_cell
+        {
+            free_cell*  next;
+        };
+
         /** 
-         * inflate the pool size
+         * the cell stride, big enough for the free list link and keep every cell max aligned
+         */
+        static size_type stride_of(size_type cell_size)
+        {
+            const size_type align = alignof(std::max_align_t);
+            size_type size = cell_size > sizeof(free_cell) ? cell_size : sizeof(free_cell);
+            return (size + align - 1) / align * align;
+        }
+
+        /** 
+         * inflate the pool size, allocate one chunk of count cells
          */
         void    inflate(size_type count)
         {
-            for( size_type i = 0; i < count; ++ i )
+            if( count == 0 )
+            {
+                return;
+            }
+
+            // fill the whole mapped slab with cells
+            count = (size_type)(slab::mapped_size((size_t)m_stride * count, m_slab_options) / m_stride);
+
+            char* chunk = static_cast<char*>(slab::allocate((size_t)m_stride * count, m_slab_options, &m_backing));
+            details::pool_chunk info;
+            info.base = chunk;
+            info.count = count;
+            m_chunks.push_back(info);
+
+            // link the cells in address order
+            for( size_type i = count; i > 0; -- i )
             {
-                pointer p = malloc(m_cell_size);
-                m_free_cells.push_back(p);
-                m_total_cells.push_back(p);
+                free_cell* cell = reinterpret_cast<free_cell*>(chunk + (i - 1) * m_stride);
+                cell->next = m_free_head;
+                m_free_head = cell;
+            }
+            m_free_cell_count += count;
+            m_total_cell_count += count;
+        }
+
+        inline  void    update_peak()
+        {
+            size_type used = m_total_cell_count - m_free_cell_count;
+            if( used > m_peak_used_cell_count )
+            {
+                m_peak_used_cell_count = used;
             }
         }
 
     private:
 
-        size_type       m_cell_size;        // 每个单元的内存大小
+        size_type           m_cell_size;        // 每个单元的内存大小
+
+        size_type           m_stride;           // 单元的间距(对齐后的单元大小)
         
-        size_type       m_grow_cell_count;  // 内存池内存膨胀的速度（增加的单元数)
+        size_type           m_grow_cell_count;  // 内存池内存膨胀的速度（增加的单元数)
+
+        free_cell*          m_free_head;        // 空闲单元链表(链接在空闲单元内部)
+
+        size_type           m_free_cell_count;  // 空闲的单元数
+
+        size_type           m_total_cell_count; // 总单元数
 
-        cell_queue_type m_free_cells;       // 空闲的单元列表
+        size_type           m_peak_used_cell_count; // 同时使用的最大单元数
 
-        cell_queue_type m_total_cells;      // 总单元列表
+        slab_options        m_slab_options;     // 内存块的分配选项
 
-        Mutex           m_mtx;              // 互斥量 
+        slab_backing        m_backing;          // 最近分配的内存块实际使用的页类型
+
+        chunk_array_type    m_chunks;           // 内存块列表
+
+        Mutex               m_mtx;              // 互斥量 
     };
 
     template<class T, class Mutex>
     class memory_pool_ex : public memory_pool<Mutex>
     {
     public:
+        typedef typename memory_pool<Mutex>::size_type  size_type;
+        typedef typename memory_pool<Mutex>::pointer    pointer;
+
         memory_pool_ex(size_type initial_cell_count, size_type grow_cell_count = 1)
-            : memory_pool(sizeof(T), initial_cell_count, grow_cell_count)
+            : memory_pool<Mutex>(sizeof(T), initial_cell_count, grow_cell_count)
         {
         }
         virtual ~memory_pool_ex(){
@@ -188,33 +374,57 @@ namespace utility
     /** 
      * memory pool fixed pool size, the pool size will not inflate when there is no free cell
      * the dvantage is that the memory buffer is continuous
+     *
+     * Align is the cell alignment and stride granularity, e.g. 64 or 128 keeps the cells
+     * used by different threads off each other's cache lines(no false sharing), the
+     * default 1 packs the cells at cell_size stride as before.
+     * with colour_count > 1 the cell i is shifted by (i % colour_count) cache lines inside
+     * its stride, so the same hot field of the neighbour cells falls into different cache sets
      */
-     template<class Mutex>
+     template<class Mutex, std::size_t Align = 1>
      class memory_pool_fixsize
      {
+        static_assert(Align > 0 && (Align & (Align - 1)) == 0, "the cell alignment must be a power of two");
+
 public:
         typedef uint32_t                size_type;
         typedef void*                   pointer;
         typedef uint32_t                cell_index_type;
         typedef std::vector<pointer>    cell_array_type;
 
+        enum
+        {
+            cache_line_size = 64,
+        };
+
+        /** the colour offsets are multiples of it, so they keep the cells Align aligned */
+        static const std::size_t colour_step = Align > (std::size_t)cache_line_size ? Align : (std::size_t)cache_line_size;
+
         /** 
          * @brief
          * @param cell_size:            each cell's meory size
          * @param total_cell_count:    total cell count
+         * @param options:             the buffer backing(huge pages, prefault)
+         * @param colour_count:        the count of cache line offsets(max(Align, cache_line_size)
+         *                             steps) the cells rotate through
          */
-        memory_pool_fixsize(size_type cell_size, size_type total_cell_count)
+        memory_pool_fixsize(size_type cell_size, size_type total_cell_count, const slab_options& options = slab_options(),
+            size_type colour_count = 1)
             :m_cell_size(cell_size)
+            ,m_colour_count(colour_count > 0 ? colour_count : 1)
+            ,m_stride(stride_of(cell_size, m_colour_count))
+            ,m_slab_options(options)
+            ,m_backing(slab_backing_heap)
         {
             m_total_cells.resize(total_cell_count, 0);
 
-            m_buffer = malloc( m_cell_size * total_cell_count );
+            // over allocate to align the first cell when Align is beyond what the backing gives
+            m_raw_buffer = slab::allocate( buffer_size(), m_slab_options, &m_backing );
+            m_buffer = (pointer)(((uintptr_t)m_raw_buffer + Align - 1) & ~(uintptr_t)(Align - 1));
 
-            void* p = m_buffer;
             for(uint32_t i = 0; i < total_cell_count; ++ i )
             {
-                m_total_cells[i] = p;
-                p = (void*)((char*)p + m_cell_size);
+                m_total_cells[i] = (char*)m_buffer + (size_t)i * m_stride + (size_t)(i % m_colour_count) * colour_step;
             }
             m_free_cell_index = total_cell_count;
         }
@@ -231,9 +441,10 @@ public:
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            if( m_buffer )
+            if( m_raw_buffer )
             {
-                free(m_buffer);
+                slab::free(m_raw_buffer, buffer_size(), m_slab_options);
+                m_raw_buffer = NULL;
                 m_buffer = NULL;
             }
               
@@ -254,7 +465,7 @@ public:
                 ret = m_total_cells[m_free_cell_index];
             }else
             {
-                ret = malloc(m_cell_size);
+                ret = overflow_allocate();
             }
             return ret;
         }
@@ -266,7 +477,7 @@ public:
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            if( p >= m_buffer && p < ((char*)m_buffer + m_cell_size * m_total_cells.size()) )
+            if( p >= m_buffer && p < ((char*)m_buffer + (size_t)m_stride * m_total_cells.size()) )
             {
                 if( m_free_cell_index < m_total_cells.size() )
                 {
@@ -278,7 +489,7 @@ public:
                 }
             }else
             {
-                free(p);
+                overflow_free(p);
             }
 
             return true;
@@ -324,11 +535,70 @@ public:
             return m_total_cells.size() * m_cell_size;
         }
 
+        /** 
+         * @brief get the backing obtained for the buffer
+         */
+        inline  slab_backing    backing()
+        {
+            return m_backing;
+        }
+
+        /** 
+         * @brief get the distance between two neighbour cells
+         */
+        inline  size_type   stride()
+        {
+            return m_stride;
+        }
+
     private:
 
         /** 
-         * try get the cell index
+         * the stride, aligned to Align and with room for the colour offsets
+         */
+        static size_type stride_of(size_type cell_size, size_type colour_count)
+        {
+            size_t size = (size_t)cell_size + (size_t)(colour_count - 1) * colour_step;
+            return (size_type)((size + Align - 1) / Align * Align);
+        }
+
+        /** 
+         * a cell from the heap when the buffer is used up, Align aligned and rounded up
+         * to Align like the buffer cells. over aligned ones keep the malloc pointer before the cell
          */
+        pointer overflow_allocate()
+        {
+            size_t size = ((size_t)m_cell_size + Align - 1) / Align * Align;
+            if( Align <= alignof(std::max_align_t) )
+            {
+                return malloc(size);
+            }
+
+            void* raw = malloc(size + Align + sizeof(void*));
+            if( !raw )
+            {
+                return NULL;
+            }
+            uintptr_t p = ((uintptr_t)raw + sizeof(void*) + Align - 1) & ~(uintptr_t)(Align - 1);
+            ((void**)p)[-1] = raw;
+            return (pointer)p;
+        }
+
+        void    overflow_free(pointer p)
+        {
+            if( Align <= alignof(std::max_align_t) )
+            {
+                free(p);
+            }else if( p )
+            {
+                free(((void**)p)[-1]);
+            }
+        }
+
+        size_t  buffer_size()
+        {
+            return (size_t)m_stride * m_total_cells.size() + (Align > alignof(std::max_align_t) ? Align : 0);
+        }
 
     private:
 
@@ -336,12 +606,215 @@ public:
 
         size_type           m_cell_size;                // 每个单元的内存大小
 
+        size_type           m_colour_count;             // 单元偏移(着色)的种类数
+
+        size_type           m_stride;                   // 单元的间距
+
         cell_array_type     m_total_cells;              // 总单元列表
 
-        pointer             m_buffer;                   // buffer的起始地址
+        pointer             m_buffer;                   // buffer的起始地址(对齐后)
+
+        pointer             m_raw_buffer;               // 分配得到的buffer地址
+
+        slab_options        m_slab_options;             // buffer的分配选项
+
+        slab_backing        m_backing;                  // buffer实际使用的页类型
 
         Mutex               m_mtx;
      };
+
+
+    /** 
+     * lock free version of memory_pool_fixsize, the free cells form a stack linked by
+     * cell index, the stack head packs the top index with a generation tag in one 64-bit
+     * word, every push/pop bumps the tag so a stale compare-and-swap can not succeed(ABA safe).
+     * when there is no free cell it falls back to malloc, like memory_pool_fixsize
+     */
+     class memory_pool_fixsize_lockfree
+     {
+public:
+        typedef uint32_t                size_type;
+        typedef void*                   pointer;
+        typedef uint32_t                cell_index_type;
+
+        /** 
+         * @brief
+         * @param cell_size:            each cell's meory size
+         * @param total_cell_count:    total cell count
+         * @param options:             the buffer backing(huge pages, prefault)
+         */
+        memory_pool_fixsize_lockfree(size_type cell_size, size_type total_cell_count, const slab_options& options = slab_options())
+            :m_cell_size(cell_size)
+            ,m_total_cell_count(total_cell_count < null_index ? total_cell_count : null_index - 1)
+            ,m_buffer(NULL)
+            ,m_head(pack(0, null_index))
+            ,m_free_cell_count(0)
+            ,m_slab_options(options)
+            ,m_backing(slab_backing_heap)
+        {
+            if( m_total_cell_count == 0 )
+            {
+                return;
+            }
+
+            m_buffer = slab::allocate( (size_t)m_cell_size * m_total_cell_count, m_slab_options, &m_backing );
+            m_next.reset(new std::atomic<cell_index_type>[m_total_cell_count]);
+            for( cell_index_type i = 0; i < m_total_cell_count; ++ i )
+            {
+                m_next[i].store(i + 1 < m_total_cell_count ? i + 1 : null_index, std::memory_order_relaxed);
+            }
+
+            m_head.store(pack(0, 0), std::memory_order_relaxed);
+            m_free_cell_count.store(m_total_cell_count, std::memory_order_release);
+        }
+
+        ~memory_pool_fixsize_lockfree()
+        {
+            clear();
+        }
+
+        /** 
+         * free the memory, the pool must not be used by other threads at the same time
+         */
+        void    clear()
+        {
+            if( m_buffer )
+            {
+                slab::free(m_buffer, (size_t)m_cell_size * m_total_cell_count, m_slab_options);
+                m_buffer = NULL;
+            }
+
+            m_next.reset();
+            m_total_cell_count = 0;
+            m_head.store(pack(0, null_index), std::memory_order_relaxed);
+            m_free_cell_count.store(0, std::memory_order_relaxed);
+        }
+
+        /** 
+         * allocate a cell 
+         */
+        pointer  allocate()
+        {
+            uint64_t head = m_head.load(std::memory_order_acquire);
+            for( ;; )
+            {
+                cell_index_type index = index_of(head);
+                if( index == null_index )
+                {
+                    return malloc(m_cell_size);
+                }
+
+                cell_index_type next = m_next[index].load(std::memory_order_relaxed);
+                if( m_head.compare_exchange_weak(head, pack(tag_of(head) + 1, next),
+                    std::memory_order_acquire, std::memory_order_acquire) )
+                {
+                    m_free_cell_count.fetch_sub(1, std::memory_order_relaxed);
+                    return (char*)m_buffer + (size_t)index * m_cell_size;
+                }
+            }
+        }
+
+        /** 
+         * reclaim the cell
+         */
+        bool    reclaim(pointer p)
+        {
+            if( m_buffer && p >= m_buffer && p < ((char*)m_buffer + (size_t)m_cell_size * m_total_cell_count) )
+            {
+                cell_index_type index = (cell_index_type)(((char*)p - (char*)m_buffer) / m_cell_size);
+
+                uint64_t head = m_head.load(std::memory_order_relaxed);
+                do
+                {
+                    m_next[index].store(index_of(head), std::memory_order_relaxed);
+                } while( !m_head.compare_exchange_weak(head, pack(tag_of(head) + 1, index),
+                    std::memory_order_release, std::memory_order_relaxed) );
+
+                m_free_cell_count.fetch_add(1, std::memory_order_relaxed);
+            }else
+            {
+                free(p);
+            }
+
+            return true;
+        }
+
+        /** 
+         * @brief get current free cell count
+         */
+        inline  size_type free_cell_count()
+        {
+            return m_free_cell_count.load(std::memory_order_relaxed);
+        }
+
+        /** 
+         * @brief get current free memory size
+         */
+        inline  size_type  free_memory_size()
+        {
+            return free_cell_count() * m_cell_size;
+        }
+
+        /** 
+         * @brief get current total cell count
+         */
+        inline  size_type   total_cell_count()
+        {
+            return m_total_cell_count;
+        }
+
+        /** 
+         * @brief get current total memory size
+         */
+        inline  size_type   total_memory_size()
+        {
+            return m_total_cell_count * m_cell_size;
+        }
+
+        /** 
+         * @brief get the backing obtained for the buffer
+         */
+        inline  slab_backing    backing()
+        {
+            return m_backing;
+        }
+
+    private:
+        static const cell_index_type null_index = 0xffffffff;
+
+        static uint64_t pack(uint32_t tag, cell_index_type index)
+        {
+            return ((uint64_t)tag << 32) | index;
+        }
+
+        static uint32_t tag_of(uint64_t head)
+        {
+            return (uint32_t)(head >> 32);
+        }
+
+        static cell_index_type index_of(uint64_t head)
+        {
+            return (cell_index_type)head;
+        }
+
+    private:
+
+        size_type                                       m_cell_size;            // 每个单元的内存大小
+
+        size_type                                       m_total_cell_count;     // 总单元数
+
+        pointer                                         m_buffer;               // buffer的起始地址
+
+        std::unique_ptr<std::atomic<cell_index_type>[]> m_next;                 // 空闲栈中每个单元的下一个单元下标
+
+        std::atomic<uint64_t>                           m_head;                 // 栈顶: [tag(32bits) | index(32bits)]
+
+        std::atomic<size_type>                          m_free_cell_count;      // 当前空闲的单元数
+
+        slab_options                                    m_slab_options;         // buffer的分配选项
+
+        slab_backing                                    m_backing;              // buffer实际使用的页类型
+     };
 }
 
 #endif
\ No newline at end of file
@@ -12,8 +12,11 @@
 
 #include <utility/noncopyable.hpp>
 #include <cstdint>
-#include <list>
+#include <new>
+#include <vector>
 #include <mutex>
+#include "pool_trim.hpp"
+#include "slab.hpp"
 
 namespace utility
 {
@@ -32,13 +35,24 @@ namespace utility
         typedef const T*        const_pointer;
         typedef const T&        const_reference;
         typedef T               value_type;
-
-
-        typedef std::list<pointer>                object_queue;
-        typedef typename object_queue::iterator   object_queue_iter;
-
-        object_allocator(size_type init_size = 0, size_type grow_size = 1) throw()
-            :m_grow_size(grow_size)
+        typedef Mutex           mutex_type;
+
+
+        typedef std::vector<details::pool_chunk>  chunk_array_type;
+
+        /** 
+         * @brief the pool grows by one contiguous chunk of grow_size objects, the free
+         * objects are linked through their own memory, with huge pages a chunk is rounded
+         * up to whole 2MB pages and filled with objects
+         */
+        object_allocator(size_type init_size = 0, size_type grow_size = 1, const slab_options& options = slab_options())
+            :m_grow_size(grow_size > 0 ? grow_size : 1)
+            ,m_free_head(nullptr)
+            ,m_free_count(0)
+            ,m_total_count(0)
+            ,m_peak_used_count(0)
+            ,m_slab_options(options)
+            ,m_backing(slab_backing_heap)
         {
             inflate(init_size);
         }
@@ -53,13 +67,15 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            auto iter = m_total_objects.begin();
-            for( iter; iter != m_total_objects.end(); ++ iter )
+            auto iter = m_chunks.begin();
+            for( ; iter != m_chunks.end(); ++ iter )
             {
-                ::operator delete (*iter);
+                slab::free(iter->base, iter->count * stride, m_slab_options);
             }
-            m_total_objects.clear();
-            m_free_objects.clear();
+            m_chunks.clear();
+            m_free_head = nullptr;
+            m_free_count = 0;
+            m_total_count = 0;
         }
 
         // allocate a object
@@ -67,15 +83,20 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            if( m_free_objects.empty() )
+            if( !m_free_head )
             {
                 inflate(m_grow_size);
             }
 
-            T* ret = m_free_objects.front();
-            m_free_objects.pop_front();
+            free_node* node = m_free_head;
+            m_free_head = node->next;
+            -- m_free_count;
+            if( m_total_count - m_free_count > m_peak_used_count )
+            {
+                m_peak_used_count = m_total_count - m_free_count;
+            }
 
-            return ret;
+            return reinterpret_cast<pointer>(node);
         }
 
         // reclain a object
@@ -83,35 +104,90 @@ namespace utility
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            m_free_objects.push_back(p);
+            free_node* node = reinterpret_cast<free_node*>(p);
+            node->next = m_free_head;
+            m_free_head = node;
+            ++ m_free_count;
+        }
+
+        /** 
+         * @brief
+         * return the chunks whose objects are all free to the system, while at least
+         * keep_free_objects free objects are left
+         * @return the bytes released
+         */
+        size_t trim(size_type keep_free_objects = 0)
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            size_type released = details::trim_chunks(m_chunks, m_free_head, m_free_count, keep_free_objects,
+                [this](const details::pool_chunk& chunk){ slab::free(chunk.base, chunk.count * stride, m_slab_options); });
+            m_free_count -= released;
+            m_total_count -= released;
+            return released * stride;
         }
 
         inline size_type free_object_count()
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_free_objects.size();
+            return m_free_count;
         }
 
         inline size_type free_memory_size()
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-             return m_free_objects.size() * sizeof(value_type);
+             return m_free_count * sizeof(value_type);
         }
 
         inline size_type total_object_count()
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_total_objects.size();
+            return m_total_count;
         }
 
         inline size_type total_memory_size()
         {
             std::lock_guard<Mutex> locker(m_mtx);
 
-            return m_total_objects.size() * sizeof(value_type);
+            return m_total_count * sizeof(value_type);
+        }
+
+        inline size_type used_object_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_total_count - m_free_count;
+        }
+
+        inline size_type peak_used_object_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_peak_used_count;
+        }
+
+        inline size_type chunk_count()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return (size_type)m_chunks.size();
+        }
+
+        // the backing obtained for the latest chunk
+        inline slab_backing backing()
+        {
+            std::lock_guard<Mutex> locker(m_mtx);
+
+            return m_backing;
+        }
+
+        // the same as free_object_count, for trim_policy
+        inline size_type free_cell_count()
+        {
+            return free_object_count();
         }
 
     public:
@@ -126,20 +202,51 @@ namespace utility
         }
 
     private:
+        struct free_node
+        {
+            free_node*  next;
+        };
+
+        // the object stride, big enough for the free list link
+        static const size_t node_size = sizeof(value_type) > sizeof(free_node) ? sizeof(value_type) : sizeof(free_node);
+        static const size_t node_align = alignof(value_type) > alignof(free_node) ? alignof(value_type) : alignof(free_node);
+        static const size_t stride = (node_size + node_align - 1) / node_align * node_align;
+
+        // allocate one chunk of count objects
         void    inflate(size_type count = POOL_INFLATE_SIZE)
         {
-            for (size_type i = 0; i < count; ++i)
+            if (count == 0)
+            {
+                return;
+            }
+
+            count = (size_type)(slab::mapped_size(stride * count, m_slab_options) / stride);
+
+            char* chunk = static_cast<char*>(slab::allocate(stride * count, m_slab_options, &m_backing));
+            details::pool_chunk info;
+            info.base = chunk;
+            info.count = count;
+            m_chunks.push_back(info);
+
+            for (size_type i = count; i > 0; --i)
             {
-                pointer p = static_cast<pointer>(::operator new (sizeof(value_type)));
-                m_free_objects.push_back(p);
-                m_total_objects.push_back(p);
+                free_node* node = reinterpret_cast<free_node*>(chunk + (i - 1) * stride);
+                node->next = m_free_head;
+                m_free_head = node;
             }
+            m_free_count += count;
+            m_total_count += count;
         }
 
     private:
-        object_queue            m_free_objects;
-        object_queue            m_total_objects;
         size_type               m_grow_size;
+        free_node*              m_free_head;
+        size_type               m_free_count;
+        size_type               m_total_count;
+        size_type               m_peak_used_count;
+        slab_options            m_slab_options;
+        slab_backing            m_backing;
+        chunk_array_type        m_chunks;
         Mutex                   m_mtx;
     };
 }   // end namespace Utility
@@ -11,10 +11,39 @@
 #define __ydk_utility_pool_object_pool_hpp__
 
 #include "object_allocator.hpp"
+#include "memory_pool.hpp"
 #include "utility/sync/null_mutex.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
 
 namespace utility
 {
+    namespace details
+    {
+        template<typename T>
+        struct object_pool_void
+        {
+            typedef void type;
+        };
+
+        /**
+         * @brief the Alloctor::mutex_type, std::mutex for the allocators not defining it
+         */
+        template<typename Alloctor, typename = void>
+        struct object_pool_mutex
+        {
+            typedef std::mutex type;
+        };
+
+        template<typename Alloctor>
+        struct object_pool_mutex<Alloctor, typename object_pool_void<typename Alloctor::mutex_type>::type>
+        {
+            typedef typename Alloctor::mutex_type type;
+        };
+    }
+
     /**
      * @brief 
      * object pool, try to decrease the cost that allocate memory and free memory
@@ -25,7 +54,81 @@ namespace utility
     class object_pool
     {
     public:
-        typedef uint32_t    size_type;
+        typedef uint32_t                                size_type;
+        typedef typename details::object_pool_mutex<Alloctor>::type mutex_type;
+        typedef memory_pool<mutex_type>                 shared_pool_type;
+
+        /** 
+         * @brief 
+         * the deleter returning the object to the pool
+         */
+        struct deleter
+        {
+            deleter(object_pool* pool = nullptr)
+                :m_pool(pool)
+            {
+            }
+
+            void operator()(T* p) const
+            {
+                m_pool->free(p);
+            }
+
+            object_pool*    m_pool;
+        };
+
+        typedef std::unique_ptr<T, deleter>             unique_ptr;
+
+        /** 
+         * @brief 
+         * std allocator for allocate_shared, the rebound control block is carved from the shared pool
+         */
+        template<typename U>
+        struct shared_allocator
+        {
+            typedef U       value_type;
+
+            template<typename V>
+            struct rebind
+            {
+                typedef shared_allocator<V> other;
+            };
+
+            shared_allocator(object_pool* pool)
+                :m_pool(pool)
+            {
+            }
+
+            template<typename V>
+            shared_allocator(const shared_allocator<V>& other)
+                :m_pool(other.m_pool)
+            {
+            }
+
+            U*      allocate(size_t n)
+            {
+                return static_cast<U*>(m_pool->shared_pool_allocate(n * sizeof(U)));
+            }
+
+            void    deallocate(U* p, size_t n)
+            {
+                m_pool->shared_pool_reclaim(p, n * sizeof(U));
+            }
+
+            template<typename V>
+            bool    operator==(const shared_allocator<V>& other) const
+            {
+                return m_pool == other.m_pool;
+            }
+
+            template<typename V>
+            bool    operator!=(const shared_allocator<V>& other) const
+            {
+                return m_pool != other.m_pool;
+            }
+
+            object_pool*    m_pool;
+        };
         
         /** 
          * @brief 
@@ -34,73 +137,86 @@ namespace utility
          */
         object_pool(size_type init_count, size_type grow_size)
             :m_allocator(init_count, grow_size)
+            ,m_grow_size(grow_size)
+            ,m_shared_pool(nullptr)
         {
 
         }
 
-        /** 
-         * @brief 
-         * allocate a object, the construct has no param
-         * @return the object pointer, return null when failed
-         */
-        inline T* allocate()
+        ~object_pool()
         {
-            return new ( m_allocator.allocate())T;
+            delete m_shared_pool.load(std::memory_order_relaxed);
         }
 
         /** 
          * @brief 
-         * allocate a object, the construct has 1 param
-         * @return the object pointer, return null when failed
+         * construct a object in the pool, the params are perfect forwarded to the constructor
+         * @return the object pointer
          */
-        template<typename P1>
-        inline T* allocate(P1 p1)
+        template<typename... Args>
+        inline T* emplace(Args&&... args)
         {
-            return new ( m_allocator.allocate())T(p1);
+            auto p = m_allocator.allocate();
+            try
+            {
+                return new (p)T(std::forward<Args>(args)...);
+            }
+            catch(...)
+            {
+                m_allocator.reclaim(p);
+                throw;
+            }
         }
 
         /** 
          * @brief 
-         * allocate a object, the construct has 2 param
-         * @return the object pointer, return null when failed
+         * allocate a object, the construct has no param(default initialized, unlike emplace())
+         * @return the object pointer
          */
-        template<typename P1, typename P2>
-        inline T* allocate(P1 p1, P2 p2)
+        inline T* allocate()
         {
-            return new ( m_allocator.allocate())T(p1, p2);
+            auto p = m_allocator.allocate();
+            try
+            {
+                return new (p)T;
+            }
+            catch(...)
+            {
+                m_allocator.reclaim(p);
+                throw;
+            }
         }
 
         /** 
          * @brief 
-         * allocate a object, the construct has 3 param
-         * @return the object pointer, return null when failed
+         * the same as emplace
          */
-        template<typename P1, typename P2, typename P3>
-        inline T* allocate(P1 p1, P2 p2, P3 p3)
+        template<typename P1, typename... Args>
+        inline T* allocate(P1&& p1, Args&&... args)
         {
-            return new ( m_allocator.allocate())T(p1, p2, p3);
+            return emplace(std::forward<P1>(p1), std::forward<Args>(args)...);
         }
 
         /** 
          * @brief 
-         * allocate a object, the construct has 4 param
-         * @return the object pointer, return null when failed
+         * construct a object owned by a unique_ptr, which returns it to the pool
          */
-        template<typename P1, typename P2, typename P3, typename P4>
-        inline T* allocate(P1 p1, P2 p2, P3 p3, P4 p4)
+        template<typename... Args>
+        inline unique_ptr make_unique(Args&&... args)
         {
-            return new ( m_allocator.allocate())T(p1, p2, p3, p4);
+            return unique_ptr(emplace(std::forward<Args>(args)...), deleter(this));
         }
 
         /** 
          * @brief 
-         * allocate a object, the construct has 5 param
-         * @return the object pointer, return null when failed
+         * construct a shared object, the control block and the object share one cell
+         * of a companion memory_pool, so it costs no heap allocation once the pool is warm.
+         * all the shared objects must be released before the pool is destroyed
          */
-        template<typename P1, typename P2, typename P3, typename P4, typename P5>
-        inline T* allocate(P1 p1, P2 p2, P3 p3, P4 p4, P5 p5)
+        template<typename... Args>
+        inline std::shared_ptr<T> make_shared(Args&&... args)
         {
-            return new ( m_allocator.allocate())T(p1, p2, p3, p4, p5);
+            return std::allocate_shared<T>(shared_allocator<T>(this), std::forward<Args>(args)...);
         }
 
         /** 
@@ -149,7 +265,47 @@ namespace utility
 
 
     private:
-        Alloctor m_allocator;    
+        /** 
+         * the cell size is the rebound control block size, only known at the first make_shared
+         */
+        void*   shared_pool_allocate(size_t size)
+        {
+            shared_pool_type* pool = m_shared_pool.load(std::memory_order_acquire);
+            if( !pool )
+            {
+                std::lock_guard<std::mutex> locker(m_shared_mtx);
+
+                pool = m_shared_pool.load(std::memory_order_relaxed);
+                if( !pool )
+                {
+                    pool = new shared_pool_type((size_type)size, 0, m_grow_size);
+                    m_shared_pool.store(pool, std::memory_order_release);
+                }
+            }
+
+            if( size > pool->cell_size() )
+            {
+                return ::operator new(size);
+            }
+            return pool->allocate();
+        }
+
+        void    shared_pool_reclaim(void* p, size_t size)
+        {
+            shared_pool_type* pool = m_shared_pool.load(std::memory_order_acquire);
+            if( size > pool->cell_size() )
+            {
+                ::operator delete(p);
+                return;
+            }
+            pool->reclaim(p);
+        }
+
+    private:
+        Alloctor                        m_allocator;    
+        size_type                       m_grow_size;
+        std::atomic<shared_pool_type*>  m_shared_pool;  // 控制块和对象共用的内存池
+        std::mutex                      m_shared_mtx;
     };
 
 } // end namespace utility
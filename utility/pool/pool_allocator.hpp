@@ -0,0 +1,259 @@
+﻿/**
+ *
+ * pool_allocator.hpp
+ *
+ * plug the pools into the standard containers:
+ * size_class_pool routes each size class(16 bytes step) to its own memory_pool,
+ * pool_allocator is a std allocator drawing from a size_class_pool, and
+ * pool_memory_resource is the std::pmr::memory_resource face of it(c++17)
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_pool_allocator_hpp__
+#define __ydk_utility_pool_pool_allocator_hpp__
+
+#include "memory_pool.hpp"
+#include <utility/noncopyable.hpp>
+#include <utility/sync/null_mutex.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define UTILITY_POOL_HAS_PMR 1
+#endif
+#endif
+
+namespace utility
+{
+    /**
+     * @brief
+     * a set of memory_pool, one for each size class, the sizes larger than
+     * max_pooled_size(or over aligned) go to the global operator new
+     */
+    template<class Mutex>
+    class size_class_pool : public utility::noncopyable
+    {
+    public:
+        typedef uint32_t                size_type;
+        typedef memory_pool<Mutex>      pool_type;
+
+        enum
+        {
+            class_granularity = 16,
+            default_max_pooled_size = 512,
+            default_grow_cell_count = 64,
+        };
+
+        /**
+         * @brief
+         * @param max_pooled_size:  the max size served by the pools
+         * @param grow_cell_count:  the infate speed of each pool
+         */
+        size_class_pool(size_type max_pooled_size = default_max_pooled_size, size_type grow_cell_count = default_grow_cell_count)
+            :m_max_pooled_size((max_pooled_size + class_granularity - 1) / class_granularity * class_granularity)
+        {
+            size_type class_count = m_max_pooled_size / class_granularity;
+            m_pools.reserve(class_count);
+            for( size_type i = 0; i < class_count; ++ i )
+            {
+                m_pools.emplace_back(new pool_type((i + 1) * class_granularity, 0, grow_cell_count));
+            }
+        }
+
+        void*   allocate(size_t size, size_t align = alignof(std::max_align_t))
+        {
+            pool_type* pool = pool_of(size, align);
+            if( pool )
+            {
+                return pool->allocate();
+            }
+            return ::operator new(size);
+        }
+
+        void    deallocate(void* p, size_t size, size_t align = alignof(std::max_align_t))
+        {
+            pool_type* pool = pool_of(size, align);
+            if( pool )
+            {
+                pool->reclaim(p);
+                return;
+            }
+            ::operator delete(p);
+        }
+
+        inline  size_type max_pooled_size()
+        {
+            return m_max_pooled_size;
+        }
+
+        /**
+         * @brief the pool serving the size class of size, null when size is not pooled
+         */
+        pool_type*  pool_of(size_t size, size_t align = alignof(std::max_align_t))
+        {
+            if( size > m_max_pooled_size || align > alignof(std::max_align_t) )
+            {
+                return nullptr;
+            }
+
+            size_t index = size > 0 ? (size - 1) / class_granularity : 0;
+            return m_pools[index].get();
+        }
+
+        /**
+         * @brief get free memory size of all the pools
+         */
+        inline  size_type free_memory_size()
+        {
+            size_type total = 0;
+            for( size_t i = 0; i < m_pools.size(); ++ i )
+            {
+                total += m_pools[i]->free_memory_size();
+            }
+            return total;
+        }
+
+        /**
+         * @brief get total memory size of all the pools
+         */
+        inline  size_type total_memory_size()
+        {
+            size_type total = 0;
+            for( size_t i = 0; i < m_pools.size(); ++ i )
+            {
+                total += m_pools[i]->total_memory_size();
+            }
+            return total;
+        }
+
+    private:
+        size_type                               m_max_pooled_size;
+        std::vector<std::unique_ptr<pool_type>> m_pools;
+    };
+
+    /**
+     * @brief
+     * std allocator adapter, the allocators copied/rebound from each other share the
+     * same Pool, the Pool must outlive the containers using it
+     */
+    template<typename T, class Pool = size_class_pool<utility::sync::null_mutex> >
+    class pool_allocator
+    {
+    public:
+        typedef T               value_type;
+        typedef T*              pointer;
+        typedef const T*        const_pointer;
+        typedef T&              reference;
+        typedef const T&        const_reference;
+        typedef size_t          size_type;
+        typedef ptrdiff_t       difference_type;
+
+        template<typename U>
+        struct rebind
+        {
+            typedef pool_allocator<U, Pool> other;
+        };
+
+        explicit pool_allocator(Pool& pool)
+            :m_pool(&pool)
+        {
+        }
+
+        template<typename U>
+        pool_allocator(const pool_allocator<U, Pool>& other)
+            :m_pool(other.pool())
+        {
+        }
+
+        T*      allocate(size_t n)
+        {
+            return static_cast<T*>(m_pool->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void    deallocate(T* p, size_t n)
+        {
+            m_pool->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        Pool*   pool() const
+        {
+            return m_pool;
+        }
+
+        template<typename U>
+        bool    operator==(const pool_allocator<U, Pool>& other) const
+        {
+            return m_pool == other.pool();
+        }
+
+        template<typename U>
+        bool    operator!=(const pool_allocator<U, Pool>& other) const
+        {
+            return m_pool != other.pool();
+        }
+
+    private:
+        Pool*   m_pool;
+    };
+
+#ifdef UTILITY_POOL_HAS_PMR
+    /**
+     * @brief
+     * std::pmr::memory_resource over a size_class_pool, usable with the std::pmr containers
+     */
+    template<class Mutex>
+    class pool_memory_resource : public std::pmr::memory_resource
+    {
+    public:
+        typedef size_class_pool<Mutex>  pool_type;
+
+        pool_memory_resource(uint32_t max_pooled_size = pool_type::default_max_pooled_size,
+            uint32_t grow_cell_count = pool_type::default_grow_cell_count)
+            :m_pool(max_pooled_size, grow_cell_count)
+        {
+        }
+
+        pool_type&  pool()
+        {
+            return m_pool;
+        }
+
+    protected:
+        virtual void*   do_allocate(size_t bytes, size_t alignment) override
+        {
+            if( alignment > alignof(std::max_align_t) )
+            {
+                return ::operator new(bytes, std::align_val_t(alignment));
+            }
+            return m_pool.allocate(bytes, alignment);
+        }
+
+        virtual void    do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            if( alignment > alignof(std::max_align_t) )
+            {
+                ::operator delete(p, std::align_val_t(alignment));
+                return;
+            }
+            m_pool.deallocate(p, bytes, alignment);
+        }
+
+        virtual bool    do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        pool_type   m_pool;
+    };
+#endif
+}
+
+#endif
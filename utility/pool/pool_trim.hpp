@@ -0,0 +1,207 @@
+﻿/**
+ *
+ * pool_trim.hpp
+ *
+ * the chunk bookkeeping shared by the chunked pools, and the watermark policy
+ * deciding when a pool should be trimmed
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_pool_trim_hpp__
+#define __ydk_utility_pool_pool_trim_hpp__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace utility
+{
+    namespace details
+    {
+        /**
+         * @brief one contiguous chunk of cells
+         */
+        struct pool_chunk
+        {
+            char*       base;
+            uint32_t    count;
+        };
+
+        inline bool pool_chunk_less(const pool_chunk& l, const pool_chunk& r)
+        {
+            return l.base < r.base;
+        }
+
+        /**
+         * @brief the index of the chunk holding p, the chunks must be sorted by address
+         */
+        inline size_t find_pool_chunk(const std::vector<pool_chunk>& chunks, const void* p)
+        {
+            pool_chunk key;
+            key.base = (char*)p;
+            key.count = 0;
+            auto iter = std::upper_bound(chunks.begin(), chunks.end(), key, pool_chunk_less);
+            return (size_t)(iter - chunks.begin()) - 1;
+        }
+
+        /**
+         * @brief
+         * release the chunks whose cells are all free, while at least keep_free_cells
+         * free cells are left, the free list(linked through Node::next) is rebuilt
+         * without the released cells in its original order, free_chunk(const pool_chunk&)
+         * gives a released chunk back
+         * @return the count of cells released
+         */
+        template<class Node, class FreeChunk>
+        uint32_t trim_chunks(std::vector<pool_chunk>& chunks, Node*& free_head, uint32_t free_count,
+            uint32_t keep_free_cells, FreeChunk free_chunk)
+        {
+            if( free_count <= keep_free_cells || chunks.empty() )
+            {
+                return 0;
+            }
+
+            std::sort(chunks.begin(), chunks.end(), pool_chunk_less);
+
+            std::vector<uint32_t> free_in_chunk(chunks.size(), 0);
+            for( Node* node = free_head; node; node = node->next )
+            {
+                ++ free_in_chunk[find_pool_chunk(chunks, node)];
+            }
+
+            // release from the highest address, the low chunks are the oldest and warmest
+            std::vector<bool> released(chunks.size(), false);
+            uint32_t released_count = 0;
+            for( size_t i = chunks.size(); i > 0; -- i )
+            {
+                const pool_chunk& chunk = chunks[i - 1];
+                if( free_in_chunk[i - 1] == chunk.count && free_count - released_count - chunk.count >= keep_free_cells )
+                {
+                    released[i - 1] = true;
+                    released_count += chunk.count;
+                }
+            }
+
+            if( released_count == 0 )
+            {
+                return 0;
+            }
+
+            Node** link = &free_head;
+            for( Node* node = free_head; node; node = node->next )
+            {
+                if( !released[find_pool_chunk(chunks, node)] )
+                {
+                    *link = node;
+                    link = &node->next;
+                }
+            }
+            *link = nullptr;
+
+            size_t kept = 0;
+            for( size_t i = 0; i < chunks.size(); ++ i )
+            {
+                if( released[i] )
+                {
+                    free_chunk(chunks[i]);
+                }
+                else
+                {
+                    chunks[kept ++] = chunks[i];
+                }
+            }
+            chunks.resize(kept);
+
+            return released_count;
+        }
+    }
+
+    /**
+     * @brief
+     * watermark trim policy: once a pool keeps more than high_watermark free cells for
+     * idle_ms, it is trimmed down to low_watermark free cells.
+     * one policy object tracks one pool
+     */
+    class trim_policy
+    {
+    public:
+        trim_policy(uint32_t low_watermark = 0, uint32_t high_watermark = 0, uint32_t idle_ms = 0)
+            :m_low_watermark(low_watermark)
+            ,m_high_watermark(high_watermark > low_watermark ? high_watermark : low_watermark)
+            ,m_idle_ms(idle_ms)
+            ,m_over_since(0)
+            ,m_over(false)
+        {
+        }
+
+        uint32_t    low_watermark() const
+        {
+            return m_low_watermark;
+        }
+
+        uint32_t    high_watermark() const
+        {
+            return m_high_watermark;
+        }
+
+        uint32_t    idle_ms() const
+        {
+            return m_idle_ms;
+        }
+
+        /**
+         * @brief
+         * @param free_cells:   the current free cell count of the pool
+         * @param now_ms:       a monotonic time in milliseconds
+         * @return whether the pool should be trimmed to low_watermark now
+         */
+        bool    check(uint32_t free_cells, uint64_t now_ms)
+        {
+            if( free_cells <= m_high_watermark )
+            {
+                m_over = false;
+                return false;
+            }
+
+            if( !m_over )
+            {
+                m_over = true;
+                m_over_since = now_ms;
+            }
+
+            if( now_ms - m_over_since < m_idle_ms )
+            {
+                return false;
+            }
+
+            m_over = false;
+            return true;
+        }
+
+        /**
+         * @brief trim the pool when the policy says so
+         * @return the bytes released
+         */
+        template<class Pool>
+        size_t  maybe_trim(Pool& pool, uint64_t now_ms)
+        {
+            if( !check(pool.free_cell_count(), now_ms) )
+            {
+                return 0;
+            }
+            return pool.trim(m_low_watermark);
+        }
+
+    private:
+        uint32_t    m_low_watermark;
+        uint32_t    m_high_watermark;
+        uint32_t    m_idle_ms;
+        uint64_t    m_over_since;
+        bool        m_over;
+    };
+}
+
+#endif
@@ -0,0 +1,194 @@
+﻿/**
+ *
+ * pool_trimmer.hpp
+ *
+ * a background thread checking the registered pools with their trim_policy and
+ * trimming the pools which stay over the high watermark for the idle time
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_pool_trimmer_hpp__
+#define __ydk_utility_pool_pool_trimmer_hpp__
+
+#include "pool_trim.hpp"
+#include <utility/noncopyable.hpp>
+#include <utility/sync/null_mutex.hpp>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <type_traits>
+
+namespace utility
+{
+    namespace details
+    {
+        template<typename T>
+        struct pool_trimmer_void
+        {
+            typedef void type;
+        };
+
+        /**
+         * @brief whether the Pool::mutex_type is null_mutex, false for the pools not telling
+         */
+        template<class Pool, typename = void>
+        struct pool_is_unlocked : std::false_type
+        {
+        };
+
+        template<class Pool>
+        struct pool_is_unlocked<Pool, typename pool_trimmer_void<typename Pool::mutex_type>::type>
+            : std::is_same<typename Pool::mutex_type, utility::sync::null_mutex>
+        {
+        };
+    }
+
+    class pool_trimmer : public utility::noncopyable
+    {
+    public:
+        typedef std::function<size_t(uint64_t now_ms)> check_func;
+
+        /**
+         * @param check_interval:   check interval in milliseconds
+         */
+        explicit pool_trimmer(uint32_t check_interval = 1000)
+            :m_thread(nullptr)
+            ,m_stopped(true)
+            ,m_check_interval(check_interval)
+            ,m_next_id(0)
+            ,m_released_bytes(0)
+        {
+        }
+
+        ~pool_trimmer()
+        {
+            stop();
+            wait_for_stop();
+
+            if( m_thread )
+            {
+                delete m_thread;
+                m_thread = nullptr;
+            }
+        }
+
+        /**
+         * @brief
+         * register a pool(memory_pool, object_allocator or any type with free_cell_count()
+         * and trim()), the pool must be removed before it is destroyed.
+         * the trimmer thread calls free_cell_count() and trim() while the owner keeps
+         * allocating, so the pool must lock them, a null_mutex pool is rejected
+         * @return the id for remove()
+         */
+        template<class Pool>
+        uint32_t    add(Pool& pool, const trim_policy& policy)
+        {
+            static_assert(!details::pool_is_unlocked<Pool>::value,
+                "pool_trimmer runs on its own thread, the pool must not use null_mutex");
+
+            trim_policy state = policy;
+            Pool* p = &pool;
+
+            std::lock_guard<std::mutex> locker(m_mtx);
+            uint32_t id = ++ m_next_id;
+            m_checks[id] = [p, state](uint64_t now_ms) mutable { return state.maybe_trim(*p, now_ms); };
+            return id;
+        }
+
+        void        remove(uint32_t id)
+        {
+            std::lock_guard<std::mutex> locker(m_mtx);
+            m_checks.erase(id);
+        }
+
+        void        start()
+        {
+            std::lock_guard<std::mutex> locker(m_mtx);
+            if( !m_thread )
+            {
+                m_stopped = false;
+                m_thread = new std::thread(std::bind(&pool_trimmer::run, this));
+            }
+        }
+
+        void        stop()
+        {
+            std::lock_guard<std::mutex> locker(m_mtx);
+            m_stopped = true;
+            m_cond.notify_all();
+        }
+
+        void        wait_for_stop()
+        {
+            if( m_thread && m_thread->joinable() )
+            {
+                m_thread->join();
+            }
+        }
+
+        /**
+         * @brief check all the pools once, on the calling thread
+         * @return the bytes released
+         */
+        size_t      check_now()
+        {
+            uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+            std::lock_guard<std::mutex> locker(m_mtx);
+
+            size_t released = 0;
+            for( auto iter = m_checks.begin(); iter != m_checks.end(); ++ iter )
+            {
+                released += iter->second(now_ms);
+            }
+            m_released_bytes += released;
+            return released;
+        }
+
+        /**
+         * @brief the total bytes released since created
+         */
+        uint64_t    released_bytes()
+        {
+            std::lock_guard<std::mutex> locker(m_mtx);
+            return m_released_bytes;
+        }
+
+    protected:
+        void        run()
+        {
+            for( ;; )
+            {
+                {
+                    std::unique_lock<std::mutex> locker(m_mtx);
+                    m_cond.wait_for(locker, std::chrono::milliseconds(m_check_interval), [this]{ return m_stopped; });
+                    if( m_stopped )
+                    {
+                        break;
+                    }
+                }
+
+                check_now();
+            }
+        }
+
+    private:
+        std::thread*                        m_thread;
+        bool                                m_stopped;
+        uint32_t                            m_check_interval;
+        uint32_t                            m_next_id;
+        uint64_t                            m_released_bytes;
+        std::map<uint32_t, check_func>      m_checks;
+        std::mutex                          m_mtx;
+        std::condition_variable             m_cond;
+    };
+}
+
+#endif
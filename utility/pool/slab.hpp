@@ -0,0 +1,194 @@
+﻿/**
+ *
+ * slab.hpp
+ *
+ * the backing memory of the pools' slabs(chunks), with the huge pages option the
+ * slab is rounded up to 2MB pages and mapped with MAP_HUGETLB, falling back to
+ * madvise(MADV_HUGEPAGE)(transparent huge pages) and then to normal pages.
+ * without the option it is plain malloc, as the pools always did
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_slab_hpp__
+#define __ydk_utility_pool_slab_hpp__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace utility
+{
+    /**
+     * @brief the backing actually obtained for a slab
+     */
+    enum slab_backing
+    {
+        slab_backing_heap = 0,                  // malloc
+        slab_backing_normal_pages,              // mmap, normal pages
+        slab_backing_transparent_huge_pages,    // mmap + madvise(MADV_HUGEPAGE)
+        slab_backing_huge_pages,                // mmap(MAP_HUGETLB)
+    };
+
+    struct slab_options
+    {
+        /**
+         * @param huge_pages:   try to back the slabs with 2MB pages
+         * @param prefault:     touch every page when the slab is allocated, so the first
+         *                      touch cost is not paid on the request path
+         */
+        slab_options(bool huge_pages = false, bool prefault = false)
+            :huge_pages(huge_pages)
+            ,prefault(prefault)
+        {
+        }
+
+        bool    huge_pages;
+        bool    prefault;
+    };
+
+    class slab
+    {
+    public:
+        enum
+        {
+            page_size = 4096,
+            huge_page_size = 2 * 1024 * 1024,
+        };
+
+        /**
+         * @brief the bytes really reserved for a slab of size bytes
+         */
+        static size_t   mapped_size(size_t size, const slab_options& options)
+        {
+            if( !use_mmap(options) )
+            {
+                return size;
+            }
+            return (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+        }
+
+        /**
+         * @brief allocate a slab of mapped_size(size) bytes, throw std::bad_alloc when failed
+         */
+        static void*    allocate(size_t size, const slab_options& options, slab_backing* backing = nullptr)
+        {
+            void* p = nullptr;
+            slab_backing obtained = slab_backing_heap;
+
+#ifdef __linux__
+            if( use_mmap(options) )
+            {
+                size_t len = mapped_size(size, options);
+
+#ifdef MAP_HUGETLB
+                p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                obtained = slab_backing_huge_pages;
+#else
+                p = MAP_FAILED;
+#endif
+                if( p == MAP_FAILED )
+                {
+                    p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if( p == MAP_FAILED )
+                    {
+                        throw std::bad_alloc();
+                    }
+
+                    obtained = slab_backing_normal_pages;
+#ifdef MADV_HUGEPAGE
+                    if( madvise(p, len, MADV_HUGEPAGE) == 0 )
+                    {
+                        obtained = slab_backing_transparent_huge_pages;
+                    }
+#endif
+                }
+
+                if( options.prefault )
+                {
+                    touch(p, len);
+                }
+                if( backing )
+                {
+                    *backing = obtained;
+                }
+                return p;
+            }
+#endif
+
+            p = malloc(size > 0 ? size : 1);
+            if( !p )
+            {
+                throw std::bad_alloc();
+            }
+            if( options.prefault )
+            {
+                touch(p, size);
+            }
+            if( backing )
+            {
+                *backing = obtained;
+            }
+            return p;
+        }
+
+        /**
+         * @brief free a slab, size and options must be the ones it was allocated with
+         */
+        static void     free(void* p, size_t size, const slab_options& options)
+        {
+            if( !p )
+            {
+                return;
+            }
+
+#ifdef __linux__
+            if( use_mmap(options) )
+            {
+                munmap(p, mapped_size(size, options));
+                return;
+            }
+#endif
+            ::free(p);
+        }
+
+        static const char* backing_name(slab_backing backing)
+        {
+            switch( backing )
+            {
+            case slab_backing_normal_pages:             return "normal_pages";
+            case slab_backing_transparent_huge_pages:   return "transparent_huge_pages";
+            case slab_backing_huge_pages:               return "huge_pages";
+            default:                                    return "heap";
+            }
+        }
+
+    private:
+        static bool     use_mmap(const slab_options& options)
+        {
+#ifdef __linux__
+            return options.huge_pages;
+#else
+            (void)options;
+            return false;
+#endif
+        }
+
+        static void     touch(void* p, size_t size)
+        {
+            volatile char* c = static_cast<volatile char*>(p);
+            for( size_t i = 0; i < size; i += page_size )
+            {
+                c[i] = 0;
+            }
+        }
+    };
+}
+
+#endif
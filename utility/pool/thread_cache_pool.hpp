@@ -0,0 +1,482 @@
+﻿/**
+ *
+ * thread_cache_pool.hpp
+ *
+ * a per-thread cache layer over memory_pool<std::mutex>, each thread owns a bounded
+ * magazine of free cells, allocate/reclaim only touch the magazine of the current thread,
+ * the magazine refills from and flushes to the shared pool in batches(one lock per batch).
+ * a cell freed by another thread goes back to the magazine that allocated it through a
+ * lock-free remote free list, which the owner drains when its magazine is empty.
+ * the magazine of an exited thread is flushed and adopted by the next new thread
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_pool_thread_cache_pool_hpp__
+#define __ydk_utility_pool_thread_cache_pool_hpp__
+
+#include "memory_pool.hpp"
+#include <utility/noncopyable.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace utility
+{
+    class thread_cache_pool : public utility::noncopyable
+    {
+    public:
+        typedef uint32_t                    size_type;
+        typedef void*                       pointer;
+        typedef memory_pool<std::mutex>     shared_pool_type;
+
+        enum
+        {
+            default_magazine_size = 64,
+        };
+
+        struct cache_stats
+        {
+            size_type               magazine_count;         // thread caches(alive or waiting for adoption)
+            size_type               cached_cell_count;      // cells parked in all the thread caches
+            std::vector<size_type>  occupancy;              // cells parked in each thread cache
+        };
+
+    protected:
+        struct magazine;
+
+        struct cell_header
+        {
+            magazine*       owner;          // the magazine allocated the cell
+            cell_header*    next_remote;    // link of the remote free list
+        };
+
+        static const size_type header_size = (sizeof(cell_header) + alignof(std::max_align_t) - 1)
+            / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        struct magazine
+        {
+            std::vector<pointer>        cells;          // free cells(with header) owned by the thread
+            std::atomic<cell_header*>   remote_head;    // cells freed by other threads
+            std::atomic<size_type>      occupancy;
+            std::atomic<bool>           in_use;         // owned by an alive thread
+
+            magazine(size_type capacity) : remote_head(nullptr), occupancy(0), in_use(true)
+            {
+                cells.reserve(capacity + 1);
+            }
+        };
+
+        struct shared_state
+        {
+            shared_pool_type                        pool;
+            size_type                               magazine_size;
+            std::mutex                              mtx;        // guard magazines
+            std::vector<std::unique_ptr<magazine>>  magazines;
+
+            shared_state(size_type cell_size, size_type initial_cell_count, size_type grow_cell_count, size_type mag_size)
+                : pool(header_size + cell_size, initial_cell_count, grow_cell_count)
+                , magazine_size(mag_size > 1 ? mag_size : 2)
+            {
+            }
+        };
+
+        struct tls_entry
+        {
+            uint64_t                    id;
+            std::weak_ptr<shared_state> state;
+            magazine*                   mag;
+        };
+
+        /**
+         * the magazines of the current thread, released when the thread exits
+         */
+        struct tls_registry
+        {
+            std::vector<tls_entry>  entries;
+            uint64_t                last_id;
+            magazine*               last_mag;
+            bool*                   destroyed;
+
+            tls_registry(bool* flag) : last_id(0), last_mag(nullptr), destroyed(flag) {}
+
+            ~tls_registry()
+            {
+                *destroyed = true;
+                for (size_t i = 0; i < entries.size(); ++i)
+                {
+                    std::shared_ptr<shared_state> st = entries[i].state.lock();
+                    if (st)
+                    {
+                        release_magazine(*st, entries[i].mag);
+                    }
+                }
+            }
+        };
+
+    public:
+        /**
+         * @brief
+         * @param cell_size:            each cell's meory size
+         * @param initial_cell_count:   initial cell count of the shared pool
+         * @param grow_cell_count:      the shared pool infate speed
+         * @param magazine_size:        max free cells cached by each thread
+         */
+        thread_cache_pool(size_type cell_size, size_type initial_cell_count, size_type grow_cell_count = 1,
+            size_type magazine_size = default_magazine_size)
+            : m_id(next_id())
+            , m_cell_size(cell_size)
+            , m_state(std::make_shared<shared_state>(cell_size, initial_cell_count, grow_cell_count, magazine_size))
+        {
+        }
+
+        ~thread_cache_pool()
+        {
+        }
+
+        /**
+         * allocate a cell
+         */
+        pointer  allocate()
+        {
+            magazine* mag = local_magazine();
+            if( !mag )
+            {
+                cell_header* h = static_cast<cell_header*>(m_state->pool.allocate());
+                h->owner = nullptr;
+                return reinterpret_cast<char*>(h) + header_size;
+            }
+
+            if( mag->cells.empty() )
+            {
+                refill(mag);
+            }
+
+            cell_header* h = static_cast<cell_header*>(mag->cells.back());
+            mag->cells.pop_back();
+            mag->occupancy.store((size_type)mag->cells.size(), std::memory_order_relaxed);
+
+            h->owner = mag;
+            return reinterpret_cast<char*>(h) + header_size;
+        }
+
+        /**
+         * reclaim the cell, to the magazine of the current thread, or to the owner magazine
+         * when the cell was allocated by another thread
+         */
+        void    reclaim(pointer p)
+        {
+            cell_header* h = header_of(p);
+            magazine* owner = h->owner;
+            magazine* mag = local_magazine();
+
+            if( owner && owner == mag )
+            {
+                mag->cells.push_back(h);
+                if( mag->cells.size() > m_state->magazine_size )
+                {
+                    flush(mag, m_state->magazine_size / 2);
+                }
+                mag->occupancy.store((size_type)mag->cells.size(), std::memory_order_relaxed);
+            }
+            else if( owner && owner->in_use.load(std::memory_order_acquire) )
+            {
+                cell_header* head = owner->remote_head.load(std::memory_order_relaxed);
+                do
+                {
+                    h->next_remote = head;
+                } while( !owner->remote_head.compare_exchange_weak(head, h, std::memory_order_release, std::memory_order_relaxed) );
+            }
+            else
+            {
+                m_state->pool.reclaim(h);
+            }
+        }
+
+        /**
+         * @brief return the cells cached by the current thread to the shared pool
+         */
+        void    flush_thread_cache()
+        {
+            magazine* mag = local_magazine();
+            if( mag )
+            {
+                drain_remote(*m_state, mag);
+                flush(mag, (size_type)mag->cells.size());
+            }
+        }
+
+        /**
+         * @brief the occupancy of the thread caches
+         */
+        cache_stats get_cache_stats()
+        {
+            std::lock_guard<std::mutex> locker(m_state->mtx);
+
+            cache_stats stats;
+            stats.magazine_count = (size_type)m_state->magazines.size();
+            stats.cached_cell_count = 0;
+            for( size_t i = 0; i < m_state->magazines.size(); ++ i )
+            {
+                size_type n = m_state->magazines[i]->occupancy.load(std::memory_order_relaxed);
+                stats.occupancy.push_back(n);
+                stats.cached_cell_count += n;
+            }
+            return stats;
+        }
+
+        inline  size_type cell_size()
+        {
+            return m_cell_size;
+        }
+
+        /**
+         * @brief get current free cell count, include the cells cached by the threads
+         */
+        inline  size_type free_cell_count()
+        {
+            return m_state->pool.free_cell_count() + get_cache_stats().cached_cell_count;
+        }
+
+        inline  size_type  free_memory_size()
+        {
+            return free_cell_count() * m_cell_size;
+        }
+
+        inline  size_type   total_cell_count()
+        {
+            return m_state->pool.total_cell_count();
+        }
+
+        inline  size_type   total_memory_size()
+        {
+            return total_cell_count() * m_cell_size;
+        }
+
+    protected:
+        static uint64_t next_id()
+        {
+            static std::atomic<uint64_t> id(0);
+            return ++ id;
+        }
+
+        static cell_header* header_of(pointer p)
+        {
+            return reinterpret_cast<cell_header*>(static_cast<char*>(p) - header_size);
+        }
+
+        static tls_registry* local_registry()
+        {
+            // after the registry destructed(thread exiting) the cells go to the shared pool directly
+            static thread_local bool destroyed = false;
+            if( destroyed )
+            {
+                return nullptr;
+            }
+
+            static thread_local tls_registry registry(&destroyed);
+            return &registry;
+        }
+
+        magazine* local_magazine()
+        {
+            tls_registry* reg = local_registry();
+            if( !reg )
+            {
+                return nullptr;
+            }
+
+            if( reg->last_id == m_id )
+            {
+                return reg->last_mag;
+            }
+
+            magazine* mag = nullptr;
+            for( size_t i = 0; i < reg->entries.size(); ++ i )
+            {
+                if( reg->entries[i].id == m_id )
+                {
+                    mag = reg->entries[i].mag;
+                    break;
+                }
+            }
+
+            if( !mag )
+            {
+                mag = acquire_magazine();
+
+                // drop the entries of the destroyed pools
+                size_t n = 0;
+                for( size_t i = 0; i < reg->entries.size(); ++ i )
+                {
+                    if( !reg->entries[i].state.expired() )
+                    {
+                        reg->entries[n ++] = reg->entries[i];
+                    }
+                }
+                reg->entries.resize(n);
+
+                tls_entry entry = { m_id, m_state, mag };
+                reg->entries.push_back(entry);
+            }
+
+            reg->last_id = m_id;
+            reg->last_mag = mag;
+            return mag;
+        }
+
+        /**
+         * adopt the magazine of an exited thread, or create a new one
+         */
+        magazine* acquire_magazine()
+        {
+            std::lock_guard<std::mutex> locker(m_state->mtx);
+
+            for( size_t i = 0; i < m_state->magazines.size(); ++ i )
+            {
+                magazine* mag = m_state->magazines[i].get();
+                if( !mag->in_use.load(std::memory_order_relaxed) )
+                {
+                    mag->in_use.store(true, std::memory_order_release);
+                    return mag;
+                }
+            }
+
+            m_state->magazines.emplace_back(new magazine(m_state->magazine_size));
+            return m_state->magazines.back().get();
+        }
+
+        static void release_magazine(shared_state& state, magazine* mag)
+        {
+            {
+                std::lock_guard<std::mutex> locker(state.mtx);
+                mag->in_use.store(false, std::memory_order_release);
+            }
+
+            drain_remote(state, mag);
+            if( !mag->cells.empty() )
+            {
+                state.pool.reclaim_n(&mag->cells[0], (size_type)mag->cells.size());
+                mag->cells.clear();
+            }
+            mag->occupancy.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * move the cells freed by the other threads to the magazine, the overflow go to the shared pool
+         */
+        static void drain_remote(shared_state& state, magazine* mag)
+        {
+            cell_header* h = mag->remote_head.exchange(nullptr, std::memory_order_acquire);
+            while( h )
+            {
+                cell_header* next = h->next_remote;
+                if( mag->cells.size() < state.magazine_size && mag->in_use.load(std::memory_order_relaxed) )
+                {
+                    mag->cells.push_back(h);
+                }
+                else
+                {
+                    state.pool.reclaim(h);
+                }
+                h = next;
+            }
+            mag->occupancy.store((size_type)mag->cells.size(), std::memory_order_relaxed);
+        }
+
+        void    refill(magazine* mag)
+        {
+            drain_remote(*m_state, mag);
+            if( mag->cells.empty() )
+            {
+                size_type count = m_state->magazine_size / 2;
+                mag->cells.resize(count);
+                m_state->pool.allocate_n(&mag->cells[0], count);
+            }
+        }
+
+        void    flush(magazine* mag, size_type count)
+        {
+            if( count == 0 )
+            {
+                return;
+            }
+
+            size_t remain = mag->cells.size() - count;
+            m_state->pool.reclaim_n(&mag->cells[remain], count);
+            mag->cells.resize(remain);
+            mag->occupancy.store((size_type)remain, std::memory_order_relaxed);
+        }
+
+    protected:
+        uint64_t                        m_id;           // unique id, never reused
+        size_type                       m_cell_size;    // 每个单元的内存大小
+        std::shared_ptr<shared_state>   m_state;        // shared by the thread caches
+    };
+
+    /**
+     * @brief object allocator with per-thread caches, can be used as the Alloctor of object_pool
+     */
+    template<typename T>
+    class thread_cache_allocator : public utility::noncopyable
+    {
+    public:
+        typedef uint32_t        size_type;
+        typedef T*              pointer;
+        typedef T&              reference;
+        typedef const T*        const_pointer;
+        typedef const T&        const_reference;
+        typedef T               value_type;
+        typedef std::mutex      mutex_type;     // for the pools working with this allocator
+
+        thread_cache_allocator(size_type init_size = 0, size_type grow_size = 1,
+            size_type magazine_size = thread_cache_pool::default_magazine_size)
+            : m_pool(sizeof(T), init_size, grow_size, magazine_size)
+        {
+        }
+
+        T* allocate()
+        {
+            return static_cast<T*>(m_pool.allocate());
+        }
+
+        void reclaim(pointer p)
+        {
+            m_pool.reclaim(p);
+        }
+
+        thread_cache_pool::cache_stats get_cache_stats()
+        {
+            return m_pool.get_cache_stats();
+        }
+
+        inline size_type free_object_count()
+        {
+            return m_pool.free_cell_count();
+        }
+
+        inline size_type free_memory_size()
+        {
+            return m_pool.free_memory_size();
+        }
+
+        inline size_type total_object_count()
+        {
+            return m_pool.total_cell_count();
+        }
+
+        inline size_type total_memory_size()
+        {
+            return m_pool.total_memory_size();
+        }
+
+    private:
+        thread_cache_pool   m_pool;
+    };
+}
+
+#endif
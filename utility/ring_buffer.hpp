@@ -1,77 +1,238 @@
 /**
  *
  * a ring_buffer implementation
- * 
- * can used for lockless programming in the situation that only one thread read and only one thread write
+ *
+ * can used for lockless programming in the situation that only one thread read and only one thread write(spsc)
+ *
+ * the head(consumer) and the tail(producer) are acquire/release atomics on separate cache lines,
+ * each side caches the other side's index and only reloads it when the queue looks full/empty.
+ * the slot count is rounded up to a power of two so the index is masked instead of %
  *
  * @author  :   yandaren1220@126.com
  * @date    :   2018-04-10
  */
 
+#ifndef __ydk_utility_ring_buffer_hpp__
+#define __ydk_utility_ring_buffer_hpp__
+
 #include <stdint.h>
+#include <atomic>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <utility/noncopyable.hpp>
 
 namespace utility{
 
+namespace details{
+    constexpr uint32_t round_up_pow2(uint32_t v, uint32_t p = 1){
+        return p >= v ? p : round_up_pow2(v, p << 1);
+    }
+}
+
 template<class T, uint32_t N>
-class ring_buffer{
+class ring_buffer : public noncopyable{
+    static_assert(N > 0 && N <= 0x80000000u, "ring_buffer size out of range");
+
 protected:
-    T     		arr_[N + 1];
-    uint32_t   	head_;
-    uint32_t   	tail_;
-    const uint32_t buffer_size;
+    enum { cache_line_size = 64 };
+
+    static const uint32_t buffer_size = details::round_up_pow2(N);
+    static const uint32_t buffer_mask = buffer_size - 1;
+
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type slot_type;
+
+    // consumer side
+    alignas(cache_line_size) std::atomic<uint32_t>  head_;
+    uint32_t                                        cached_tail_;
+
+    // producer side
+    alignas(cache_line_size) std::atomic<uint32_t>  tail_;
+    uint32_t                                        cached_head_;
+
+    alignas(cache_line_size) slot_type              arr_[buffer_size];
 
 public:
-    ring_buffer() :head_(0), tail_(0), buffer_size(N + 1){
+    ring_buffer() :head_(0), cached_tail_(0), tail_(0), cached_head_(0){
+    }
+
+    ~ring_buffer(){
+        clear();
     }
 
     bool empty(){
-        return head_ == tail_;
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
     }
 
     bool full(){
-        return (tail_ + 1) % buffer_size == head_;
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) >= N;
     }
-    
+
+    /**
+     * @brief destroy the elements left, not thread safe, call it when both sides are quiet
+     */
     void clear(){
-		head_ = 0;
-		tail_ = 0;
-	}
-	
-	uint32_t size(){
-		return tail_ >= head_ ? (tail_ - head_) : (buffer_size + tail_ - head_);
-	}
-	
-	uint32_t max_size(){
-		return N;
-	}
-
-    T* pop(){
-        if (empty()){
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        uint32_t t = tail_.load(std::memory_order_relaxed);
+        for (; h != t; ++h){
+            slot(h)->~T();
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        cached_head_ = 0;
+        cached_tail_ = 0;
+    }
+
+    uint32_t size(){
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    uint32_t max_size(){
+        return N;
+    }
+
+    /**
+     * @brief producer, construct the element in place
+     * @return false when the buffer is full
+     */
+    template<typename... Args>
+    bool emplace(Args&&... args){
+        uint32_t t = tail_.load(std::memory_order_relaxed);
+        if (!writable(t, 1)){
+            return false;
+        }
+
+        new (slot(t)) T(std::forward<Args>(args)...);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& v){
+        return emplace(v);
+    }
+
+    bool push(T&& v){
+        return emplace(std::move(v));
+    }
+
+    /**
+     * @brief producer, push at most count elements copied from src with one release
+     * @return the count of elements pushed
+     */
+    uint32_t push_n(const T* src, uint32_t count){
+        uint32_t t = tail_.load(std::memory_order_relaxed);
+        count = writable_count(t, count);
+
+        for (uint32_t i = 0; i < count; ++i){
+            new (slot(t + i)) T(src[i]);
+        }
+        tail_.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief consumer, the element at the head, nullptr when the buffer is empty,
+     * the element is valid until pop_front()
+     */
+    T* front(){
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        if (!readable(h, 1)){
             return nullptr;
         }
+        return slot(h);
+    }
 
-        T* r = &arr_[head_];
-        head_ = (head_ + 1) % buffer_size;
-        return r;
+    /**
+     * @brief consumer, destroy the element at the head
+     */
+    void pop_front(){
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        if (!readable(h, 1)){
+            return;
+        }
+
+        slot(h)->~T();
+        head_.store(h + 1, std::memory_order_release);
     }
 
-    bool push(T& v){
-        if (full()){
+    /**
+     * @brief consumer, move the element at the head to v
+     * @return false when the buffer is empty
+     */
+    bool pop(T& v){
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        if (!readable(h, 1)){
             return false;
         }
 
-        arr_[tail_] = v;
-        tail_ = (tail_ + 1) % buffer_size;
+        T* p = slot(h);
+        v = std::move(*p);
+        p->~T();
+        head_.store(h + 1, std::memory_order_release);
         return true;
     }
 
+    /**
+     * @brief consumer, move at most count elements to dst with one release
+     * @return the count of elements popped
+     */
+    uint32_t pop_n(T* dst, uint32_t count){
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        count = readable_count(h, count);
+
+        for (uint32_t i = 0; i < count; ++i){
+            T* p = slot(h + i);
+            dst[i] = std::move(*p);
+            p->~T();
+        }
+        head_.store(h + count, std::memory_order_release);
+        return count;
+    }
+
     int head(){
-        return head_;
+        return head_.load(std::memory_order_relaxed) & buffer_mask;
     }
 
     int tail(){
-        return tail_;
+        return tail_.load(std::memory_order_relaxed) & buffer_mask;
+    }
+
+protected:
+    T* slot(uint32_t index){
+        return reinterpret_cast<T*>(&arr_[index & buffer_mask]);
+    }
+
+    bool writable(uint32_t t, uint32_t count){
+        if (N - (t - cached_head_) >= count){
+            return true;
+        }
+        cached_head_ = head_.load(std::memory_order_acquire);
+        return N - (t - cached_head_) >= count;
+    }
+
+    uint32_t writable_count(uint32_t t, uint32_t count){
+        if (!writable(t, count)){
+            count = N - (t - cached_head_);
+        }
+        return count;
+    }
+
+    bool readable(uint32_t h, uint32_t count){
+        if (cached_tail_ - h >= count){
+            return true;
+        }
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        return cached_tail_ - h >= count;
+    }
+
+    uint32_t readable_count(uint32_t h, uint32_t count){
+        if (!readable(h, count)){
+            count = cached_tail_ - h;
+        }
+        return count;
     }
 };
 
-} // end namespace utility
\ No newline at end of file
+} // end namespace utility
+
+#endif
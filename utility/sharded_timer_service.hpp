@@ -0,0 +1,292 @@
+﻿/**
+ * @brief sharded_timer_service.hpp
+ *
+ * one time_wheel per shard(usually per io thread), a thread binds itself to a shard
+ * and then adds and ticks the timers of its shard without any lock.
+ * other threads reach a shard through its lock-free mailbox: post_timer adds a fire
+ * and forget timer, applied at the owner's next tick. cancel works from any thread,
+ * it only marks the timer cancelled(see time_wheel::cancel)
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __ydk_utility_sharded_timer_service_hpp__
+#define __ydk_utility_sharded_timer_service_hpp__
+
+#include <stdint.h>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <utility/noncopyable.hpp>
+#include <utility/mpmc_queue.hpp>
+#include <utility/time_wheel.hpp>
+#include <utility/sync/null_mutex.hpp>
+
+namespace utility
+{
+    class sharded_timer_service : public noncopyable
+    {
+    public:
+        enum {
+            mailbox_size = 1024,
+        };
+
+        /**
+         * @brief a timer of a shard, valid until the timer fires or is cancelled
+         */
+        struct handle {
+            uint32_t        shard;
+            timer_handle*   timer;
+
+            handle() : shard(0), timer(nullptr) {
+            }
+
+            bool valid() const {
+                return timer != nullptr;
+            }
+        };
+
+        typedef std::function<void()> wakeup_func;
+
+    protected:
+        /** the shard's wheel, only touched by the owner thread but for cancel */
+        typedef time_wheel<utility::sync::null_mutex> shard_wheel;
+
+        /** a posted timer */
+        struct command {
+            uint64_t        expire_time;        // in milliseconds since epoch
+            timer_handler   fn;
+
+            command() : expire_time(0) {
+            }
+        };
+
+        struct shard {
+            shard_wheel                         wheel;
+            mpmc_queue<command, mailbox_size>   mailbox;
+            std::atomic<bool>                   has_overflow;
+            std::mutex                          overflow_mtx;
+            std::vector<command>                overflow;       // the commands when the mailbox is full
+            wakeup_func                         wakeup;         // wake the owner's event loop
+
+            shard() : has_overflow(false) {
+            }
+
+            // the mailbox is cache line aligned, which the global operator new only
+            // honours since c++17, so over allocate and keep the raw pointer before the shard
+            static void* operator new(std::size_t size) {
+                void* raw = ::operator new(size + alignof(shard) + sizeof(void*));
+                uintptr_t p = ((uintptr_t)raw + sizeof(void*) + alignof(shard) - 1) & ~(uintptr_t)(alignof(shard) - 1);
+                ((void**)p)[-1] = raw;
+                return (void*)p;
+            }
+
+            static void operator delete(void* p) {
+                if (p) {
+                    ::operator delete(((void**)p)[-1]);
+                }
+            }
+        };
+
+        struct binding {
+            const sharded_timer_service*    service;
+            uint32_t                        shard;
+        };
+
+        std::vector<std::unique_ptr<shard>>     shards_;
+        std::atomic<uint32_t>                   next_post_shard_;
+
+    public:
+        explicit sharded_timer_service(uint32_t shard_count) : next_post_shard_(0) {
+            shard_count = shard_count > 0 ? shard_count : 1;
+            for (uint32_t i = 0; i < shard_count; ++i) {
+                shards_.emplace_back(new shard());
+            }
+        }
+
+        uint32_t shard_count() const {
+            return (uint32_t)shards_.size();
+        }
+
+        /**
+         * @brief make the calling thread the owner of the shard, a thread is bound to
+         * one shard of one service at a time
+         */
+        void bind_shard(uint32_t index) {
+            current_binding().service = this;
+            current_binding().shard = index % shard_count();
+        }
+
+        /**
+         * @brief set the function waking the owner of the shard after a foreign thread
+         * posted to its mailbox, e.g. post a tick to the owner's io_service
+         */
+        void set_wakeup(uint32_t index, const wakeup_func& func) {
+            shards_[index % shard_count()]->wakeup = func;
+        }
+
+        /**
+         * @brief the shard the calling thread is bound to, -1 when not bound
+         */
+        int32_t current_shard() const {
+            const binding& b = current_binding();
+            return b.service == this ? (int32_t)b.shard : -1;
+        }
+
+        /**
+         * @brief add a timer to the shard of the calling thread, which must be bound
+         *
+         * @param fn            : void() call back, called on the owner thread
+         * @param time_in_milli : the timer will expired in time_in_milli milliseconds
+         */
+        template<class Handler>
+        handle add_timer(Handler&& fn, uint64_t time_in_milli) {
+            handle h;
+            int32_t index = current_shard();
+            if (index < 0) {
+                return h;
+            }
+
+            shard& s = *shards_[index];
+            h.shard = (uint32_t)index;
+            h.timer = s.wheel.make_timer(wrap(s, std::forward<Handler>(fn)), time_in_milli);
+            s.wheel.add_timer(h.timer);
+            return h;
+        }
+
+        /**
+         * @brief add a fire and forget timer to any shard from any thread
+         */
+        template<class Handler>
+        void post_timer(uint32_t index, Handler&& fn, uint64_t time_in_milli) {
+            shard& s = *shards_[index % shard_count()];
+
+            command cmd;
+            cmd.expire_time = gettime64_since_epoch() + time_in_milli;
+            cmd.fn = wrap(s, std::forward<Handler>(fn));
+            send(s, std::move(cmd));
+        }
+
+        /**
+         * @brief post_timer to the shards in turn
+         */
+        template<class Handler>
+        void post_timer(Handler&& fn, uint64_t time_in_milli) {
+            post_timer(next_post_shard_.fetch_add(1, std::memory_order_relaxed), std::forward<Handler>(fn), time_in_milli);
+        }
+
+        /**
+         * @brief cancel the timer from any thread, lock-free, the owner's next tick reclaims
+         * it. a timer which already fired is ignored
+         */
+        void cancel(const handle& h) {
+            if (!h.valid() || h.shard >= shard_count()) {
+                return;
+            }
+
+            shards_[h.shard]->wheel.cancel(h.timer);
+        }
+
+        /**
+         * @brief apply the mailbox and tick the wheel of the calling thread's shard
+         */
+        void tick() {
+            int32_t index = current_shard();
+            if (index < 0) {
+                return;
+            }
+
+            shard& s = *shards_[index];
+            drain(s);
+            s.wheel.tick();
+        }
+
+        /**
+         * @brief the next expiry of the calling thread's shard, see time_wheel::next_expiry
+         */
+        uint64_t next_expiry() {
+            int32_t index = current_shard();
+            if (index < 0) {
+                return time_wheel<>::no_expiry;
+            }
+            return shards_[index]->wheel.next_expiry();
+        }
+
+    protected:
+        static binding& current_binding() {
+            static thread_local binding b = { nullptr, 0 };
+            return b;
+        }
+
+        /**
+         * @brief the wheel call back, calls fn and frees the node on the owner thread
+         */
+        template<class Handler>
+        struct fire_and_free {
+            shard_wheel*    wheel;
+            Handler         fn;
+
+            void operator()(timer_handle* h) {
+                fn();
+                wheel->free_timer(h);
+            }
+        };
+
+        template<class Handler>
+        static timer_handler wrap(shard& s, Handler&& fn) {
+            typedef typename std::decay<Handler>::type handler_type;
+            return timer_handler(fire_and_free<handler_type>{ &s.wheel, std::forward<Handler>(fn) });
+        }
+
+        void send(shard& s, command&& cmd) {
+            if (!s.mailbox.push(std::move(cmd))) {
+                std::lock_guard<std::mutex> locker(s.overflow_mtx);
+                s.overflow.push_back(std::move(cmd));
+                s.has_overflow.store(true, std::memory_order_release);
+            }
+
+            if (s.wakeup) {
+                s.wakeup();
+            }
+        }
+
+        void drain(shard& s) {
+            command cmd;
+            while (s.mailbox.pop(cmd)) {
+                apply(s, cmd);
+            }
+
+            if (s.has_overflow.load(std::memory_order_acquire)) {
+                std::vector<command> overflow;
+                {
+                    std::lock_guard<std::mutex> locker(s.overflow_mtx);
+                    overflow.swap(s.overflow);
+                    s.has_overflow.store(false, std::memory_order_relaxed);
+                }
+                for (auto& c : overflow) {
+                    apply(s, c);
+                }
+            }
+        }
+
+        void apply(shard& s, command& cmd) {
+            uint64_t now = gettime64_since_epoch();
+            uint64_t time_in_milli = cmd.expire_time > now ? cmd.expire_time - now : 0;
+            s.wheel.add_timer(s.wheel.make_timer(std::move(cmd.fn), time_in_milli));
+            cmd.fn = nullptr;
+        }
+
+        static uint64_t gettime64_since_epoch() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+        }
+    };
+}
+
+#endif
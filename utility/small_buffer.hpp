@@ -0,0 +1,94 @@
+﻿/**
+ *
+ * small_buffer.hpp
+ *
+ * a buffer with InlineCapacity bytes of inline storage, small payloads(e.g. control
+ * messages) are stored inside the object, so create() costs only one allocation(the
+ * shared_ptr control block together with the object). the storage spills to the heap,
+ * or to the buffer pool when UTILITY_BUFFER_USE_POOL is defined, only when it grows
+ * past the inline capacity
+ *
+ * @author  :   yandaren1220@126.com
+ * @date    :   2026-10-16
+ */
+
+#ifndef __utility_small_buffer_hpp__
+#define __utility_small_buffer_hpp__
+
+#include "buffer.hpp"
+#include "buffer_pool.hpp"
+#include <stdint.h>
+
+namespace utility
+{
+template<int32_t InlineCapacity = 128>
+class small_buffer : public buffer
+{
+    static_assert(InlineCapacity > 0, "the inline capacity must be positive");
+
+protected:
+    char    inline_data_[InlineCapacity];
+
+public:
+    small_buffer(int32_t size = InlineCapacity, bool auto_extend = false)
+    {
+        is_auto_extend_ = auto_extend;
+        if (size <= InlineCapacity){
+            data_ = inline_data_;
+            capacity_ = InlineCapacity;
+        }
+        else{
+            allocate(size);
+        }
+    }
+
+    static buffer_ptr create(int32_t size = InlineCapacity, bool auto_extend = false)
+    {
+#ifdef UTILITY_BUFFER_USE_POOL
+        return std::allocate_shared<small_buffer>(buffer_pool_allocator<small_buffer>(), size, auto_extend);
+#else
+        return std::make_shared<small_buffer>(size, auto_extend);
+#endif
+    }
+
+    virtual ~small_buffer(){
+        if (data_ && !is_wrappered_){
+            free_storage(data_, capacity_);
+        }
+        data_ = nullptr;
+    }
+
+    /**
+     * @brief whether the bytes are still stored inline
+     */
+    bool is_inline(){
+        return data_ == inline_data_;
+    }
+
+protected:
+    virtual char* alloc_storage(int32_t& size) override
+    {
+#ifdef UTILITY_BUFFER_USE_POOL
+        return static_cast<char*>(buffer_pool::allocate(size));
+#else
+        return new char[size];
+#endif
+    }
+
+    virtual void  free_storage(char* p, int32_t size) override
+    {
+        if (p == inline_data_){
+            return;
+        }
+
+#ifdef UTILITY_BUFFER_USE_POOL
+        buffer_pool::reclaim(p, size);
+#else
+        (void)size;
+        delete[] p;
+#endif
+    }
+};
+}
+
+#endif
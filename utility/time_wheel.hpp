@@ -9,37 +9,114 @@
 #define __ydk_utility_time_wheel_hpp__
 
 #include <stdint.h>
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <chrono>
+#include <new>
+#include <vector>
 #include <utility/noncopyable.hpp>
+#include <utility/inline_function.hpp>
 #include <utility/sync/null_mutex.hpp>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace utility
 {
+    /** 
+     * an opaque (slot index, generation) pair into the wheel's node table, a handle
+     * whose timer has been freed is stale, and every call ignores it
+     */
     typedef void*   timer_handle;
-    typedef std::function<void(timer_handle* handle)> timer_handler;
 
-    template<class Mutex = utility::sync::null_mutex>
+    /** 
+     * the timer call back, stored inside the timer node, a callable larger than
+     * 48 bytes is moved to the heap. it is move-only(it used to be a std::function),
+     * pass make_timer the callable itself or std::move a timer_handler
+     */
+    typedef inline_function<void(timer_handle* handle), 48> timer_handler;
+
+    /** 
+     * how a periodic timer schedules its next run
+     */
+    enum timer_repeat_policy {
+        timer_fixed_rate = 0,       // every period from the first expiry, a late run does not shift the later ones
+        timer_fixed_delay,          // one period after the call back returned
+    };
+
+    /** 
+     * @brief
+     * the layout of a time_wheel: the clock, the time unit and the granularity of one
+     * slot(in Unit), the index bits of the root level(tv1) and of each upper level, and
+     * the level count(root included)
+     */
+    template<class Clock, class Unit, uint64_t Granularity, int32_t RootBits, int32_t LevelBits, int32_t Levels>
+    struct time_wheel_layout {
+        static_assert(Granularity > 0, "the granularity must be positive");
+        static_assert(RootBits > 0 && RootBits <= 16, "the root bits out of range");
+        static_assert(LevelBits > 0 && LevelBits <= 6, "a level has at most 64 slots");
+        static_assert(Levels >= 2, "the wheel needs at least two levels");
+        static_assert(RootBits + (Levels - 1) * LevelBits < 64, "the wheel covers more than 63 bits");
+
+        typedef Clock   clock_type;
+        typedef Unit    unit_type;
+
+        static const uint64_t granularity = Granularity;
+        static const int32_t root_bits = RootBits;
+        static const int32_t level_bits = LevelBits;
+        static const int32_t levels = Levels;
+    };
+
+    /** 10ms slots, 256 root slots and 4 levels of 64 slots, covers about 497 days */
+    typedef time_wheel_layout<std::chrono::high_resolution_clock, std::chrono::milliseconds, 10, 8, 6, 5> default_time_wheel_layout;
+
+    /** 100us slots for the retransmit timers, covers about 4.9 days */
+    typedef time_wheel_layout<std::chrono::steady_clock, std::chrono::microseconds, 100, 8, 6, 5> microsecond_time_wheel_layout;
+
+    /** 1s slots and 3 levels for the session idle timeouts, covers about 3 days */
+    typedef time_wheel_layout<std::chrono::steady_clock, std::chrono::seconds, 1, 6, 6, 3> second_time_wheel_layout;
+
+    template<class Mutex = utility::sync::null_mutex, class Layout = default_time_wheel_layout>
     class time_wheel : public noncopyable
     {
     protected:
-        /** 时间粒度(精度) */
-        static const uint64_t time_granularity = 10;
+        typedef typename Layout::clock_type clock_type;
+        typedef typename Layout::unit_type  unit_type;
+
+        /** 时间粒度(精度), 单位为Layout::unit_type */
+        static const uint64_t time_granularity = Layout::granularity;
+
+        /** 定时器节点表每次增长的节点数 */
+        static const uint32_t node_block_size = 256;
+
+        /** the handle bits of the slot index(+1), the rest is the generation */
+        static const int32_t handle_index_bits = sizeof(uintptr_t) >= 8 ? 32 : 22;
+        static const uintptr_t handle_index_mask = ((uintptr_t)1 << handle_index_bits) - 1;
+        static const uint32_t handle_gen_mask = (uint32_t)(~(uintptr_t)0 >> handle_index_bits);
+
+        /** 定时器节点表的最大块数, 受句柄中下标的位数限制 */
+        static const uint32_t max_node_blocks = (uint32_t)(handle_index_mask / node_block_size);
 
         /*
+         default layout:
          |<-----------------------------32 bits ------------------------------>|
          |<- tvn_bits->|<- tvn_bits->|<- tvn_bits->|<- tvn_bits->|<- tvr_bits->|
          |<-  6 bits ->|<-  6 bits ->|<-  6 bits ->|<-  6 bits ->|<-  8 bits ->|
          | idxs of tv5 | idxs of tv4 | idxs of tv3 | idxs of tv2 | idxs of tv1 |
          */
-        static const int32_t tvn_bits = 6;
-        static const int32_t tvr_bits = 8;
-        static const int32_t tvn_size = (1 << tvn_bits);    // 64
-        static const int32_t tvr_size = (1 << tvr_bits);    // 256
-        static const int32_t tvn_mask = (tvn_size - 1);     // 63
-        static const int32_t tvr_mark = (tvr_size - 1);     // 255
-        static const int32_t max_wheel_lvl = 5;             // 5级
+        static const int32_t tvn_bits = Layout::level_bits;
+        static const int32_t tvr_bits = Layout::root_bits;
+        static const int32_t tvn_size = (1 << tvn_bits);
+        static const int32_t tvr_size = (1 << tvr_bits);
+        static const int32_t tvn_mask = (tvn_size - 1);
+        static const int32_t tvr_mark = (tvr_size - 1);
+        static const int32_t max_wheel_lvl = Layout::levels;
+        static const int32_t tv1_bitmap_words = (tvr_size + 63) / 64;
+        static const uint64_t tvn_slot_bits = ~(uint64_t)0 >> (64 - tvn_size);
+        static const uint64_t max_count = ~(uint64_t)0 >> (64 - (tvr_bits + (max_wheel_lvl - 1) * tvn_bits));
 
     protected:
         struct timer_node_link;
@@ -49,8 +126,33 @@ namespace utility
             timer_node*         next;
             timer_handler       fn;
             uint64_t            expired_time;
+            uint64_t            period;             // periodic timer, in unit_type
+            uint64_t            due;                // periodic timer, the exact expiry in unit_type
+            std::atomic<uint64_t> ctl;              // generation << 32 | state
+            uint32_t            index;              // the slot in the node table
+            uint32_t            flags;
 
-            timer_node() : link(nullptr), expired_time(0) { prev = next = this; }
+            timer_node() : link(nullptr), expired_time(0), period(0), due(0), ctl(0), index(0), flags(0) { prev = next = this; }
+        };
+
+        enum {
+            node_periodic       = 0x01,
+            node_fixed_delay    = 0x02,
+            node_compensate     = 0x04,
+        };
+
+        /** 
+         * the node states, the low half of timer_node::ctl. cancel only moves a node to
+         * st_cancelled, the node is reclaimed later by tick, and the generation is bumped
+         * then, which makes the old handles stale
+         */
+        enum {
+            st_free = 0,                // in the free list
+            st_idle,                    // made, not added yet
+            st_pending,                 // in the wheel
+            st_firing,                  // the call back is running
+            st_fired,                   // one shot timer fired, waits for free_timer
+            st_cancelled,               // tombstone, waits for tick to reclaim it
         };
 
         struct timer_node_link {
@@ -118,107 +220,201 @@ namespace utility
         };
 
         typedef timer_node_link_arr<tvr_size> wheel_root;
-        typedef timer_node_link_arr<tvr_size> wheel;
+        typedef timer_node_link_arr<tvn_size> wheel;
 
     protected:
 
         wheel_root                  tv1_;                   // 第一级时间轮
-        wheel                       tv2_;                   // 第二级时间轮
-        wheel                       tv3_;                   // 第三级时间轮
-        wheel                       tv4_;                   // 第四级时间轮
-        wheel                       tv5_;                   // 第五级时间轮
+        wheel                       tvn_[max_wheel_lvl - 1];            // 第二级及以上的时间轮
+        uint64_t                    tv1_bitmap_[tv1_bitmap_words];      // 第一级时间轮非空槽位图
+        uint64_t                    tvn_bitmap_[max_wheel_lvl - 1];     // 第二级及以上时间轮非空槽位图
         uint64_t                    base_time_;             // 基准时间
+        std::atomic<timer_node**>   node_dir_;              // 定时器节点表的块目录, 块不会释放
+        uint32_t                    node_dir_size_;         // 块目录的大小
+        std::vector<std::unique_ptr<timer_node*[]>> node_dirs_;         // 所有的块目录, 旧目录保留给无锁的lookup
+        std::atomic<uint32_t>       node_capacity_;         // 节点表已分配的节点数
+        timer_node*                 free_nodes_;            // 空闲节点链表, 由mtx_保护
+        timer_node*                 graveyard_;             // tick中待回收的节点, 由mtx_保护
+        std::atomic<timer_node*>    retired_;               // 已取消且不在时间轮中的节点, 无锁入栈
         Mutex                       mtx_;
 
     public:
-        time_wheel() {
+        time_wheel() : node_dir_(nullptr), node_dir_size_(0), node_capacity_(0), free_nodes_(nullptr), graveyard_(nullptr), retired_(nullptr) {
             base_time_ = gettime64_since_epoch() / time_granularity;
+            for (auto& bits : tv1_bitmap_) {
+                bits = 0;
+            }
+            for (auto& bits : tvn_bitmap_) {
+                bits = 0;
+            }
         }
 
         ~time_wheel() {
+            // destroy the node table, with the call backs of the timers still alive
+            timer_node** dir = node_dir_.load(std::memory_order_relaxed);
+            uint32_t block_count = node_capacity_.load(std::memory_order_relaxed) / node_block_size;
+            for (uint32_t i = 0; i < block_count; ++i) {
+                delete[] dir[i];
+            }
         }
 
     public:
         /** 
          * @brief 
          *
-         * @param handler       : the timer call back function
-         * @param time_in_milli : the timer will expired in time_in_milli milliseconds
+         * @param handler       : the timer call back function, any callable of void(timer_handle*)
+         * @param time_in_milli : the timer will expired in time_in_milli milliseconds(the
+         *                        layout's unit_type, e.g. microseconds for the microsecond layout)
+         * @return nullptr when the handler is empty(an empty std::function or a null pointer)
          */
-        timer_handle*     make_timer(const timer_handler& handler, uint64_t time_in_milli) {
-            timer_node* node = new timer_node();
-            node->fn = handler;
+        template<class Handler>
+        timer_handle*     make_timer(Handler&& handler, uint64_t time_in_milli) {
+            timer_handler fn(std::forward<Handler>(handler));
+            if (!fn) {
+                return nullptr;
+            }
+
+            timer_node* node = alloc_node();
+            node->fn = std::move(fn);
             node->expired_time = (uint64_t)(gettime64_since_epoch() + time_in_milli) / time_granularity;
 
-            return (timer_handle*)node;
+            return handle_of(node);
         }
 
         /** 
-         * @brief add timer
+         * @brief 
+         * make a periodic timer, after add_timer it runs every period until remove_timer,
+         * which may be called from the call back itself. tick re-arms the same node, the
+         * call back must not add_timer it
+         *
+         * @param handler           : the timer call back function, any callable of void(timer_handle*)
+         * @param period            : the period in the layout's unit_type, at least one granularity
+         * @param first_delay       : the first run is first_delay after now
+         * @param policy            : timer_fixed_rate or timer_fixed_delay
+         * @param compensate_drift  : timer_fixed_rate only, keep the runs on the exact grid of
+         *                            first expiry + n * period(periods missed by a late tick are
+         *                            skipped), otherwise the next run is one period after the slot
+         *                            the timer fired in, and the lateness adds up
+         * @return nullptr when the handler is empty
          */
-        void            add_timer(timer_handle* handle) {
-            timer_node* nd = (timer_node*)handle;
-            if (!nd) {
-                return;
+        template<class Handler>
+        timer_handle*     make_periodic_timer(Handler&& handler, uint64_t period, uint64_t first_delay,
+            timer_repeat_policy policy = timer_fixed_rate, bool compensate_drift = true) {
+            timer_handler fn(std::forward<Handler>(handler));
+            if (!fn) {
+                return nullptr;
+            }
+
+            timer_node* node = alloc_node();
+            node->fn = std::move(fn);
+            node->period = period > time_granularity ? period : time_granularity;
+            node->due = gettime64_since_epoch() + first_delay;
+            node->expired_time = node->due / time_granularity;
+            node->flags = node_periodic;
+            if (policy == timer_fixed_delay) {
+                node->flags |= node_fixed_delay;
+            }
+            else if (compensate_drift) {
+                node->flags |= node_compensate;
             }
 
+            return handle_of(node);
+        }
+
+        /** 
+         * @brief add timer, a one shot timer may be added again after(or in) its call back,
+         * a stale or cancelled handle is ignored
+         */
+        void            add_timer(timer_handle* handle) {
             // locker
             std::lock_guard<Mutex> locker(mtx_);
 
-            add_timer_internal(nd);
+            add_timer_locked(handle);
         }
 
         /** 
-         * @brief try remove the timer
+         * @brief 
+         * cancel the timer and free it, from any thread without taking the wheel lock.
+         * the node only becomes a tombstone, the wheel skips it and reclaims it(and
+         * destroys its call back) in a later tick. a call back already running is
+         * not waited for
+         * @return false if the handle is stale
          */
-        void            remove_timer(timer_handle* handle) {
-
-            timer_node* nd = (timer_node*)handle;
+        bool            cancel(timer_handle* handle) {
+            uint32_t gen = 0;
+            timer_node* nd = lookup(handle, gen);
             if (!nd) {
-                return;
+                return false;
             }
 
-            // locker
-            {
-                std::lock_guard<Mutex> locker(mtx_);
-                if (nd->link) {
-                    nd->link->remove(nd);
+            uint64_t ctl = nd->ctl.load(std::memory_order_acquire);
+            uint32_t st = st_free;
+            do {
+                st = (uint32_t)ctl;
+                if (((uint32_t)(ctl >> 32) & handle_gen_mask) != gen || st == st_free || st == st_cancelled) {
+                    return false;
                 }
+            } while (!nd->ctl.compare_exchange_weak(ctl, (ctl & ~(uint64_t)0xffffffff) | st_cancelled,
+                std::memory_order_acq_rel, std::memory_order_acquire));
+
+            // out of the wheel and not in tick's hands, hand it to the next tick
+            if (st == st_idle || st == st_fired) {
+                timer_node* head = retired_.load(std::memory_order_relaxed);
+                do {
+                    nd->next = head;
+                } while (!retired_.compare_exchange_weak(head, nd, std::memory_order_release, std::memory_order_relaxed));
             }
-
-            delete nd;
+            return true;
         }
 
+        /** 
+         * @brief try remove the timer, the same as cancel
+         */
+        void            remove_timer(timer_handle* handle) {
+            cancel(handle);
+        }
 
         /** 
-         * @brief free timer resource
+         * @brief free timer resource, the same as cancel
          */
         void            free_timer(timer_handle* handle) {
-
-            timer_node* nd = (timer_node*)handle;
-            if (!nd) {
-                return;
-            }
-
-            delete nd;
+            cancel(handle);
         }
 
         /** 
          * @brief tick
          */
         void            tick() {
-            uint64_t cur_time = gettime64_since_epoch() / time_granularity;
+            uint64_t now = gettime64_since_epoch();
+            uint64_t cur_time = now / time_granularity;
 
             // lock
             mtx_.lock();
+
+            // the nodes cancelled out of the wheel
+            timer_node* retired = retired_.exchange(nullptr, std::memory_order_acquire);
+            while (retired) {
+                timer_node* next = retired->next;
+                bury(retired);
+                retired = next;
+            }
+
             while (cur_time >= base_time_) {
                 int32_t idx = (int32_t)(base_time_ & tvr_mark);
 
-                if (!idx &&
-                    !cascade(tv2_, index_n(0)) &&
-                    !cascade(tv3_, index_n(1)) &&
-                    !cascade(tv4_, index_n(2))) {
-                    cascade(tv5_, index_n(3));
+                // a level cascades when all the levels below it wrapped around
+                if (!idx) {
+                    for (int32_t lvl = 0; lvl < max_wheel_lvl - 1 && !cascade(lvl, index_n(lvl)); ++lvl) {
+                    }
+                }
+
+                // jump over the empty slots, to the next occupied slot or the next round
+                // which has to cascade, but not beyond now
+                if (!test_tv1_bit(idx)) {
+                    int32_t next = next_tv1_bit(idx);
+                    uint64_t next_time = base_time_ - idx + (next >= 0 ? next : tvr_size);
+                    base_time_ = next_time < cur_time + 1 ? next_time : cur_time + 1;
+                    continue;
                 }
 
                 ++base_time_;
@@ -229,29 +425,355 @@ namespace utility
                     timer_node* n = expired_link.first();
 
                     // remove the timer
-                    expired_link.remove(n);
+                    remove_from_link(&expired_link, n);
+
+                    // a cancelled node is skipped, the node can not be reclaimed while firing
+                    uint64_t ctl = n->ctl.load(std::memory_order_acquire);
+                    uint64_t firing = (ctl & ~(uint64_t)0xffffffff) | st_firing;
+                    if ((uint32_t)ctl != st_pending ||
+                        !n->ctl.compare_exchange_strong(ctl, firing, std::memory_order_acq_rel)) {
+                        bury(n);
+                        continue;
+                    }
 
-                    // unlock
+                    bool periodic = (n->flags & node_periodic) != 0;
+                    bool fixed_delay = (n->flags & node_fixed_delay) != 0;
                     mtx_.unlock();
 
                     // call timer handler function
-                    n->fn((timer_handle*)n);
+                    n->fn(handle_of(n));
+
+                    uint64_t done_time = fixed_delay ? gettime64_since_epoch() : now;
 
                     // lock
                     mtx_.lock();
+                    uint64_t expected = firing;
+                    uint64_t after = (firing & ~(uint64_t)0xffffffff) | (periodic ? st_pending : st_fired);
+                    if (n->ctl.compare_exchange_strong(expected, after, std::memory_order_acq_rel)) {
+                        if (periodic) {
+                            // re-arm the same node
+                            rearm(n, done_time);
+                            add_timer_internal(n);
+                        }
+                    }
+                    else if ((uint32_t)expected == st_cancelled && !n->link) {
+                        bury(n);
+                    }
+                    // else the one shot call back added it again, cancelled or not it is
+                    // in a slot now, and the wheel drops the tombstone when it gets there
                 }
             }
 
+            // reclaim the dead nodes, their call backs are destroyed out of the lock
+            timer_node* dead = graveyard_;
+            graveyard_ = nullptr;
+
             // unlock
             mtx_.unlock();
+
+            if (dead) {
+                reclaim_nodes(dead);
+            }
+        }
+
+        /** 
+         * @brief 
+         * a lower bound of the next timer expiry in milliseconds(the layout's unit_type) since
+         * the clock's epoch, exact when the timer is in the first level, otherwise the time the
+         * timer's slot cascades. no_expiry when there is no timer, O(levels)
+         */
+        uint64_t        next_expiry() {
+            std::lock_guard<Mutex> locker(mtx_);
+
+            return next_expiry_internal();
         }
 
+    public:
+        static const uint64_t no_expiry = ~(uint64_t)0;
+
     protected:
+        /** 
+         * @brief the next expiry of a periodic node which just ran, now is the tick's clock or,
+         * for fixed delay, the clock after the call back
+         */
+        void            rearm(timer_node* n, uint64_t now) {
+            if (n->flags & node_fixed_delay) {
+                n->due = now + n->period;
+            }
+            else if (n->flags & node_compensate) {
+                n->due += n->period;
+                if (n->due <= now) {
+                    // skip the periods a late tick missed, stay on the grid
+                    n->due += ((now - n->due) / n->period + 1) * n->period;
+                }
+            }
+            else {
+                // base_time_ has moved just past the slot the timer fired in
+                n->due = (base_time_ - 1) * time_granularity + n->period;
+            }
+            n->expired_time = n->due / time_granularity;
+        }
+
+        /** 
+         * @brief next_expiry with mtx_ held
+         */
+        uint64_t        next_expiry_internal() {
+            uint64_t next_time = no_expiry;
+
+            int32_t idx = (int32_t)(base_time_ & tvr_mark);
+            int32_t next = next_tv1_bit(idx);
+            if (next >= 0) {
+                next_time = base_time_ - idx + next;
+            }
+            else if ((next = next_tv1_bit(0)) >= 0) {
+                next_time = base_time_ - idx + tvr_size + next;
+            }
+
+            for (int32_t lvl = 0; lvl < max_wheel_lvl - 1; ++lvl) {
+                uint64_t bits = tvn_bitmap_[lvl];
+                if (!bits) {
+                    continue;
+                }
+
+                // the slots after the current one cascade first, the current slot a full cycle later
+                int32_t shift = tvr_bits + lvl * tvn_bits;
+                int32_t cur = index_n(lvl);
+                uint64_t rotated = rotate_right(bits, (cur + 1) & tvn_mask);
+                uint64_t distance = (uint64_t)lowest_bit(rotated) + 1;
+                uint64_t cascade_time = ((base_time_ >> shift) + distance) << shift;
+                if (cascade_time < next_time) {
+                    next_time = cascade_time;
+                }
+            }
+
+            if (next_time == no_expiry) {
+                return no_expiry;
+            }
+            return next_time * time_granularity;
+        }
+
+        static timer_handle* handle_of(timer_node* nd) {
+            uintptr_t gen = (uintptr_t)((nd->ctl.load(std::memory_order_relaxed) >> 32) & handle_gen_mask);
+            return (timer_handle*)((gen << handle_index_bits) | ((uintptr_t)nd->index + 1));
+        }
 
-        int32_t         cascade(wheel& wl, int32_t index) {
+        /** 
+         * @brief the node of a handle and the handle's generation, nullptr if the index is
+         * out of the table, the generation is checked by the caller
+         */
+        timer_node*     lookup(timer_handle* handle, uint32_t& gen) {
+            uintptr_t value = (uintptr_t)handle;
+            uintptr_t index = value & handle_index_mask;
+            if (index == 0 || index > node_capacity_.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            --index;
+            gen = (uint32_t)(value >> handle_index_bits);
+            timer_node** dir = node_dir_.load(std::memory_order_acquire);
+            return &dir[index / node_block_size][index % node_block_size];
+        }
+
+        /** 
+         * @brief add_timer with mtx_ held, the added node or nullptr
+         */
+        timer_node*     add_timer_locked(timer_handle* handle) {
+            uint32_t gen = 0;
+            timer_node* nd = lookup(handle, gen);
+            if (!nd) {
+                return nullptr;
+            }
+
+            uint64_t ctl = nd->ctl.load(std::memory_order_acquire);
+            do {
+                uint32_t st = (uint32_t)ctl;
+                if (((uint32_t)(ctl >> 32) & handle_gen_mask) != gen) {
+                    return nullptr;
+                }
+                if (st != st_idle && st != st_fired && !(st == st_firing && !(nd->flags & node_periodic))) {
+                    return nullptr;
+                }
+            } while (!nd->ctl.compare_exchange_weak(ctl, (ctl & ~(uint64_t)0xffffffff) | st_pending,
+                std::memory_order_acq_rel, std::memory_order_acquire));
+
+            add_timer_internal(nd);
+            return nd;
+        }
+
+        timer_node*     alloc_node() {
+            // the nodes cancelled out of the wheel are reclaimed here as well as in tick,
+            // or a wheel seldom ticked(e.g. timer_manger sleeping with nothing pending)
+            // would grow the table for every made and freed timer
+            if (retired_.load(std::memory_order_relaxed)) {
+                timer_node* retired = retired_.exchange(nullptr, std::memory_order_acquire);
+                if (retired) {
+                    reclaim_nodes(retired);
+                }
+            }
+
+            std::lock_guard<Mutex> locker(mtx_);
+            if (!free_nodes_) {
+                grow_nodes();
+            }
+
+            timer_node* nd = free_nodes_;
+            free_nodes_ = nd->next;
+            nd->ctl.store((nd->ctl.load(std::memory_order_relaxed) & ~(uint64_t)0xffffffff) | st_idle, std::memory_order_release);
+            return nd;
+        }
+
+        void            grow_nodes() {
+            uint32_t capacity = node_capacity_.load(std::memory_order_relaxed);
+            uint32_t block_index = capacity / node_block_size;
+            if (block_index >= max_node_blocks) {
+                throw std::bad_alloc();
+            }
+
+            // a full directory is copied to one twice as large, the old one stays alive
+            // for the lookups still reading it
+            timer_node** dir = node_dir_.load(std::memory_order_relaxed);
+            if (block_index >= node_dir_size_) {
+                uint32_t size = node_dir_size_ ? node_dir_size_ * 2 : 16;
+                std::unique_ptr<timer_node*[]> new_dir(new timer_node*[size]);
+                for (uint32_t i = 0; i < size; ++i) {
+                    new_dir[i] = i < block_index ? dir[i] : nullptr;
+                }
+                node_dirs_.reserve(node_dirs_.size() + 1);
+                dir = new_dir.get();
+                node_dirs_.push_back(std::move(new_dir));
+                node_dir_size_ = size;
+                node_dir_.store(dir, std::memory_order_release);
+            }
+
+            timer_node* block = new timer_node[node_block_size];
+            for (uint32_t i = node_block_size; i > 0; --i) {
+                timer_node* nd = &block[i - 1];
+                nd->index = capacity + i - 1;
+                nd->next = free_nodes_;
+                free_nodes_ = nd;
+            }
+
+            dir[block_index] = block;
+            node_capacity_.store(capacity + node_block_size, std::memory_order_release);
+        }
+
+        /** 
+         * @brief a cancelled node left the wheel, tick reclaims it, with mtx_ held
+         */
+        void            bury(timer_node* nd) {
+            nd->next = graveyard_;
+            graveyard_ = nd;
+        }
+
+        /** 
+         * @brief free the nodes linked through next, the generation is bumped so the
+         * old handles become stale
+         */
+        void            reclaim_nodes(timer_node* dead) {
+            for (timer_node* nd = dead; nd; nd = nd->next) {
+                nd->fn.reset();
+                nd->flags = 0;
+            }
+
+            std::lock_guard<Mutex> locker(mtx_);
+            while (dead) {
+                timer_node* nd = dead;
+                dead = dead->next;
+
+                uint64_t gen = (nd->ctl.load(std::memory_order_relaxed) >> 32) + 1;
+                nd->ctl.store((gen << 32) | st_free, std::memory_order_release);
+                nd->next = free_nodes_;
+                free_nodes_ = nd;
+            }
+        }
+
+        static int32_t  lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward64(&index, bits);
+            return (int32_t)index;
+#else
+            return __builtin_ctzll(bits);
+#endif
+        }
+
+        static uint64_t rotate_right(uint64_t bits, int32_t n) {
+            return n ? (((bits >> n) | (bits << (tvn_size - n))) & tvn_slot_bits) : bits;
+        }
 
+        bool            test_tv1_bit(int32_t idx) {
+            return (tv1_bitmap_[idx >> 6] >> (idx & 63)) & 1;
+        }
+
+        /** 
+         * @brief the first occupied slot of the first level at or after idx, -1 if none
+         */
+        int32_t         next_tv1_bit(int32_t idx) {
+            for (int32_t w = idx >> 6; w < tv1_bitmap_words; ++w) {
+                uint64_t bits = tv1_bitmap_[w];
+                if (w == (idx >> 6)) {
+                    bits &= ~(uint64_t)0 << (idx & 63);
+                }
+                if (bits) {
+                    return (w << 6) + lowest_bit(bits);
+                }
+            }
+            return -1;
+        }
+
+        /** 
+         * @brief the level and slot index of a link, level 0 is tv1_
+         */
+        void            locate(timer_node_link* link, int32_t& lvl, int32_t& idx) {
+            if (link >= tv1_.arr && link < tv1_.arr + tvr_size) {
+                lvl = 0;
+                idx = (int32_t)(link - tv1_.arr);
+                return;
+            }
+
+            for (lvl = 1; lvl < max_wheel_lvl; ++lvl) {
+                wheel& wl = tvn_[lvl - 1];
+                if (link >= wl.arr && link < wl.arr + tvn_size) {
+                    idx = (int32_t)(link - wl.arr);
+                    return;
+                }
+            }
+        }
+
+        void            add_to_link(timer_node_link* link, timer_node* node) {
+            if (link->empty()) {
+                int32_t lvl = 0, idx = 0;
+                locate(link, lvl, idx);
+                if (lvl == 0) {
+                    tv1_bitmap_[idx >> 6] |= (uint64_t)1 << (idx & 63);
+                }
+                else {
+                    tvn_bitmap_[lvl - 1] |= (uint64_t)1 << idx;
+                }
+            }
+            link->add_to_tail(node);
+        }
+
+        void            remove_from_link(timer_node_link* link, timer_node* node) {
+            link->remove(node);
+            if (link->empty()) {
+                int32_t lvl = 0, idx = 0;
+                locate(link, lvl, idx);
+                if (lvl == 0) {
+                    tv1_bitmap_[idx >> 6] &= ~((uint64_t)1 << (idx & 63));
+                }
+                else {
+                    tvn_bitmap_[lvl - 1] &= ~((uint64_t)1 << idx);
+                }
+            }
+        }
+
+        int32_t         cascade(int32_t lvl, int32_t index) {
+
+            wheel& wl = tvn_[lvl];
             timer_node_link link = wl.arr[index];
             wl.arr[index].head = nullptr;
+            tvn_bitmap_[lvl] &= ~((uint64_t)1 << index);
 
             // re add the nodes of the link to the time wheel
             timer_node* n = link.head;
@@ -259,8 +781,14 @@ namespace utility
             while (n) {
                 next = n->next;
 
-                // readd to the time wheel
-                add_timer_internal(n);
+                // readd to the time wheel, a tombstone is reclaimed instead
+                if ((uint32_t)n->ctl.load(std::memory_order_acquire) == st_cancelled) {
+                    n->link = nullptr;
+                    bury(n);
+                }
+                else {
+                    add_timer_internal(n);
+                }
 
                 n = next;
 
@@ -282,23 +810,7 @@ namespace utility
 
             timer_node_link* link = nullptr;
             uint64_t count = expired_time - base_time_;
-            if (count < tvr_size) {
-                uint32_t idx = expired_time & tvr_mark;
-                link = &tv1_.arr[idx];
-            }
-            else if (count < 1 << (tvr_bits + tvn_bits)) {
-                uint32_t idx = (expired_time >> tvr_bits) & tvn_mask;
-                link = &tv2_.arr[idx];
-            }
-            else if (count < 1 << (tvr_bits + 2 * tvn_bits)) {
-                uint32_t idx = (expired_time >> (tvr_bits + tvn_bits)) & tvn_mask;
-                link = &tv3_.arr[idx];
-            }
-            else if (count < 1 << ((tvr_bits + 3 * tvn_bits))) {
-                uint32_t idx = (expired_time >> (tvr_bits + 2 * tvn_bits)) & tvn_mask;
-                link = &tv4_.arr[idx];
-            }
-            else if ((int32_t)count < 0) {
+            if ((int64_t)count < 0) {
                 // if the timer expired when insert
                 /*
                 * Can happen if you add a timer with expires == jiffies,
@@ -306,26 +818,37 @@ namespace utility
                 */
                 link = &tv1_.arr[base_time_ & tvr_mark];
             }
+            else if (count < tvr_size) {
+                uint32_t idx = expired_time & tvr_mark;
+                link = &tv1_.arr[idx];
+            }
             else {
-                /* If the timeout is larger than 0xffffffff on 64-bit
-                * architectures then we use the maximum timeout:
+                /* If the timeout is larger than the wheel covers
+                * then we use the maximum timeout:
                 */
-                if (count > 0xffffffffUL) {
-                    count = 0xffffffffUL;
+                if (count > max_count) {
+                    count = max_count;
                     expired_time = count + base_time_;
                 }
-                uint32_t idx = (expired_time >> (tvr_bits + 3 * tvn_bits)) & tvn_mask;
-                link = &tv5_.arr[idx];
+
+                // the lowest level whose range holds the count
+                int32_t lvl = 0;
+                while (lvl < max_wheel_lvl - 2 && (count >> (tvr_bits + (lvl + 1) * tvn_bits)) != 0) {
+                    ++lvl;
+                }
+
+                uint32_t idx = (expired_time >> (tvr_bits + lvl * tvn_bits)) & tvn_mask;
+                link = &tvn_[lvl].arr[idx];
             }
 
             // add to tail
-            link->add_to_tail(node);
+            add_to_link(link, node);
         }
 
         static uint64_t gettime64_since_epoch()
         {
-            return std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+            return std::chrono::duration_cast<unit_type>(
+                clock_type::now().time_since_epoch()).count();
         }
     };
 }
@@ -19,6 +19,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <functional>
+#include <utility/pool/pool_allocator.hpp>
 
 #ifdef _WIN32
 #define snprintf _snprintf
@@ -126,12 +128,18 @@ namespace utility
         typedef std::function<void(log_lvl log_level, const char* data, int32_t len)> log_handler_func;
 
     protected:
+        /** the map nodes come from node_pool_, guarded by mtx_ as the maps */
+        typedef utility::size_class_pool<utility::sync::null_mutex> node_pool_type;
+
         /** <expired_time, task_id> */
-        typedef std::multimap<uint64_t, uint64_t> expire_map_type;
+        typedef std::multimap<uint64_t, uint64_t, std::less<uint64_t>,
+            utility::pool_allocator<std::pair<const uint64_t, uint64_t>, node_pool_type> > expire_map_type;
 
         /** <task_id, expired_time> */
-        typedef std::unordered_map<uint64_t, timeout_task::ptr> time_out_task_map_type;
+        typedef std::unordered_map<uint64_t, timeout_task::ptr, std::hash<uint64_t>, std::equal_to<uint64_t>,
+            utility::pool_allocator<std::pair<const uint64_t, timeout_task::ptr>, node_pool_type> > time_out_task_map_type;
 
+        node_pool_type              node_pool_;
         expire_map_type             expire_map_;
         time_out_task_map_type      time_out_task_map_;
         std::string                 name_;
@@ -144,7 +152,10 @@ namespace utility
         uint32_t                    check_interval_;            // 检测间隔(ms)
 
     public:
-        timeout_task_manager():thread_(nullptr), stopped_(true), next_task_id_(0), internal_logger_(nullptr), check_interval_(10){
+        timeout_task_manager()
+            :expire_map_(expire_map_type::key_compare(), expire_map_type::allocator_type(node_pool_))
+            ,time_out_task_map_(0, time_out_task_map_type::hasher(), time_out_task_map_type::key_equal(), time_out_task_map_type::allocator_type(node_pool_))
+            ,thread_(nullptr), stopped_(true), next_task_id_(0), internal_logger_(nullptr), check_interval_(10){
             started_ = false;
         }
 
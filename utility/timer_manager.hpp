@@ -13,19 +13,40 @@
 #include <chrono>
 #include <atomic>
 #include <functional>
+#include <condition_variable>
 #include <utility/time_wheel.hpp>
 
 namespace utility
 {
-    class timer_manger : public time_wheel<std::mutex>
+    /** 
+     * the manager thread sleeps until the wheel's next expiry, add_timer wakes it
+     * early when the new timer is due before that.
+     * the wheel is a protected base, so every add goes through the waking add_timer
+     * instead of the base one through a time_wheel<std::mutex>&
+     */
+    class timer_manger : protected time_wheel<std::mutex>
     {
+        typedef time_wheel<std::mutex>  base_type;
+
+    public:
+        using base_type::make_timer;
+        using base_type::make_periodic_timer;
+        using base_type::cancel;
+        using base_type::remove_timer;
+        using base_type::free_timer;
+        using base_type::tick;
+        using base_type::next_expiry;
+        using base_type::no_expiry;
+
     protected:
-        std::thread*           thread_;
-        std::atomic<bool>      started_;
-        volatile    bool       stopped_;
+        std::thread*                thread_;
+        std::atomic<bool>           started_;
+        volatile    bool            stopped_;
+        std::condition_variable     cond_;
+        uint64_t                    sleep_until_;       // 线程睡眠的截止时间(ms), 0表示线程未睡眠
 
     public:
-        timer_manger() :thread_(nullptr), stopped_(true){
+        timer_manger() :thread_(nullptr), stopped_(true), sleep_until_(0){
             started_ = false;
         }
 
@@ -47,7 +68,26 @@ namespace utility
         }
 
         void stop() {
+            std::lock_guard<std::mutex> locker(mtx_);
             stopped_ = true;
+            cond_.notify_one();
+        }
+
+        /** 
+         * @brief add timer, wake the manager thread if the timer is due before it wakes up
+         */
+        void add_timer(timer_handle* handle) {
+            std::lock_guard<std::mutex> locker(mtx_);
+
+            timer_node* nd = add_timer_locked(handle);
+            if (!nd) {
+                return;
+            }
+
+            if (sleep_until_ && nd->expired_time * time_granularity < sleep_until_) {
+                sleep_until_ = 0;
+                cond_.notify_one();
+            }
         }
 
         void wait_for_stop() {
@@ -61,7 +101,25 @@ namespace utility
             while (!stopped_) {
                 tick();
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::unique_lock<std::mutex> locker(mtx_);
+                if (stopped_) {
+                    break;
+                }
+
+                uint64_t next = next_expiry_internal();
+                uint64_t now = gettime64_since_epoch();
+                if (next <= now) {
+                    continue;
+                }
+
+                sleep_until_ = next;
+                if (next == no_expiry) {
+                    cond_.wait(locker, [this] { return stopped_ || !sleep_until_; });
+                }
+                else {
+                    cond_.wait_for(locker, std::chrono::milliseconds(next - now), [this] { return stopped_ || !sleep_until_; });
+                }
+                sleep_until_ = 0;
             }
         }
     };